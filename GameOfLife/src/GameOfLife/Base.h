@@ -1,6 +1,11 @@
 #pragma once
 
+#include <cstdint>
+
+#include "ChangeSet.h"
 #include "HeapArray.h"
+#include "Rule.h"
+#include "Viewport.h"
 
 namespace GameOfLife
 {
@@ -13,23 +18,79 @@ namespace GameOfLife
 	template<size_t sideLength>
 	using cell_colors_t = heap_array<uint8_t, gridLength<sideLength> * 4>;
 
-	template<size_t sideLength>
 	class IEngine
 	{
 	public:
 		virtual ~IEngine() {}
 
+		virtual size_t getWidth() const = 0;
+		virtual size_t getHeight() const = 0;
+
 		virtual void setCellState(size_t x, size_t y, bool isAlive) = 0;
 		virtual void computeNextGeneration() = 0;
 		virtual void clearCells() = 0;
+
+		// Reads the cells [x, x + nbCells) of the row y into words, bit b of words[i] being the state of the cell x + 64 * i + b
+		virtual void getRowCells(size_t x, size_t y, uint64_t* words, size_t nbCells) const = 0;
+
+		// Overwrites the cells [x, x + nbCells) of the row y, bit b of words[i] being the state of the cell x + 64 * i + b.
+		// Engines override it to write whole words at a time.
+		virtual void setRowCells(size_t x, size_t y, uint64_t const* words, size_t nbCells)
+		{
+			for (size_t i = 0; i < nbCells; i++)
+				setCellState(x + i, y, (words[i / 64] >> (i % 64)) & 1);
+		}
+
+		// Engines running rules with more than two states override these, getRowCells() only reading their alive cells.
+		// states[i] is the state of the cell x + i, 0 being dead and 1 alive. setRowStates() returns false on two states.
+		virtual uint8_t getNbStates() const { return 2; }
+		virtual bool setRowStates(size_t /*x*/, size_t /*y*/, uint8_t const* /*states*/, size_t /*nbCells*/) { return false; }
+
+		// Engines able to run other rules than B3/S23 override these, setRule() returning false for the rules they can't run
+		virtual bool setRule(Rule const& rule) { return rule == Rule(); }
+		virtual Rule getRule() const { return Rule(); }
+
+		// Engines running on an unbounded plane override these : their cells are those of a getWidth() x getHeight()
+		// frame of the plane, whose top left cell is at the origin
+		virtual bool isUnbounded() const { return false; }
+		virtual CellCoordinates getOrigin() const { return CellCoordinates{ 0, 0 }; }
+		virtual void setOrigin(CellCoordinates /*origin*/) {}
+
+		// Unbounded engines override it to hash every alive cell of the plane with its coordinates, for the period detection,
+		// and engines with more than two states to hash the states of the cells.
+		// Returns false when the alive cells of the frame are the whole state.
+		virtual bool hashCells(uint64_t& /*hash*/) const { return false; }
+
+		// Engines keeping count of their alive cells, or with cells outside the frame, override it.
+		// Returns false when the population is to be counted from the rows of the frame.
+		virtual bool countPopulation(uint64_t& /*population*/) const { return false; }
+
+		// Engines able to skip ahead override it
+		virtual void advance(uint64_t generations)
+		{
+			for (uint64_t i = 0; i < generations; i++)
+				computeNextGeneration();
+		}
+
+		// Engines able to tell which cells each generation changed override these.
+		// Once tracking is enabled, collectChanges() adds the tiles changed since its last call to changes
+		// and returns true; false means that every cell must be considered changed.
+		virtual void setChangeTracking(bool /*enabled*/) {}
+		virtual bool collectChanges(ChangeSet& /*changes*/) { return false; }
 	};
 
-	template<size_t sideLength>
 	class IView
 	{
 	public:
 		virtual ~IView() {}
 
-		virtual cell_colors_t<sideLength> const& computeColors() const = 0;
+		// Writes the RGBA colors of the cells within the viewport to pixels, row after row
+		virtual void computeColors(Viewport const& viewport, uint8_t* pixels) const = 0;
+
+		// Same, pixels already holding the colors of the viewport before the given changes
+		virtual void updateColors(Viewport const& viewport, ChangeSet const& /*changes*/, uint8_t* pixels) const
+		{
+			computeColors(viewport, pixels);
+		}
 	};
 }
\ No newline at end of file
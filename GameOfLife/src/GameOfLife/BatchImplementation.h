@@ -0,0 +1,283 @@
+#pragma once
+
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+#include <vector>
+
+#include "BitPackedImplementation.h"
+#include "Periodicity.h"
+#include "Rule.h"
+#include "ThreadPool.h"
+
+namespace GameOfLife
+{
+    // What became of one universe of a BatchEngine
+    struct UniverseResult
+    {
+        uint64_t population;
+        uint64_t generation;                // Generations computed
+        bool     isSettled;                 // Whether it came back to an earlier state
+        uint64_t stabilizationGeneration;   // First generation of the cycle it settled in
+        uint32_t period;                    // 1 for still lifes, 0 when not settled
+    };
+
+
+
+    // --------------------- BATCH ENGINE ----------------------//
+    // Runs many small independent tori, for soup searches and parameter sweeps.
+    // The universes are bit packed one after the other in a single arena, the two generations of each one
+    // next to each other and starting on a cache line. Every thread takes a range of universes and computes
+    // all the requested generations of one universe before moving to the next, while it is in its cache.
+    // A universe stops once it comes back to one of its last maxPeriod states. Their hashes are compared,
+    // the hash of a universe being updated for the words that changed while its next generation is computed.
+    class BatchEngine final
+    {
+    public:
+        BatchEngine(size_t nbUniverses, size_t width, size_t height, uint32_t maxPeriod = 64,
+                    size_t nbThreads = ThreadPool::defaultThreadCount())
+            : m_nbUniverses(nbUniverses), m_width(width), m_height(height),
+              m_rowWords((width + bitsPerWord - 1) / bitsPerWord), m_lastBit((width - 1) % bitsPerWord),
+              m_generationWords((m_rowWords * height + wordsPerLine - 1) / wordsPerLine * wordsPerLine),
+              m_maxPeriod(std::max<uint32_t>(maxPeriod, 1)),
+              m_arena(nbUniverses * 2 * m_generationWords + wordsPerLine, 0),
+              m_universes(nbUniverses), m_hashes(nbUniverses * m_maxPeriod, 0),
+              m_threadPool(nbThreads)
+        {
+            // The first universe starts on a cache line
+            const size_t misalignment = reinterpret_cast<uintptr_t>(m_arena.data()) / sizeof(word_t) % wordsPerLine;
+            m_firstWord = misalignment == 0 ? 0 : wordsPerLine - misalignment;
+        }
+
+        inline size_t getUniverseCount() const { return m_nbUniverses; }
+        inline size_t getWidth() const         { return m_width; }
+        inline size_t getHeight() const        { return m_height; }
+
+        inline void setRule(Rule const& rule) { m_rule = rule; resetAll(); }
+        inline Rule getRule() const           { return m_rule; }
+
+        inline bool getCellState(size_t universe, size_t x, size_t y) const
+        {
+            return (cellsOf(universe)[y * m_rowWords + x / bitsPerWord] >> (x % bitsPerWord)) & 1;
+        }
+        void setCellState(size_t universe, size_t x, size_t y, bool isAlive);
+
+        // Fills a universe with cells alive with the given probability, the same seed giving the same soup
+        void randomize(size_t universe, uint64_t seed, double density = 0.5);
+        void clearUniverse(size_t universe);
+
+        // Computes up to the given number of generations of the universes that haven't settled
+        void advance(uint64_t generations);
+
+        UniverseResult getResult(size_t universe) const;
+        inline bool isSettled(size_t universe) const { return m_universes[universe].period != 0; }
+
+    private:
+        static constexpr size_t wordsPerLine = 64 / sizeof(word_t);
+
+        struct Universe
+        {
+            uint8_t  parity     = 0;    // Which of its two generations holds the current one
+            uint64_t generation = 0;
+            uint64_t firstHashed = 0;   // Generation of the oldest hash kept, the ones before changed since
+            bool     isHashed   = false;
+            uint64_t hash       = 0;    // Sum of the hashWord() of its current words
+            uint64_t stabilizationGeneration = 0;
+            uint32_t period     = 0;
+        };
+
+        size_t                 m_nbUniverses;
+        size_t                 m_width;
+        size_t                 m_height;
+        size_t                 m_rowWords;
+        size_t                 m_lastBit;
+        size_t                 m_generationWords;   // Words of one generation of one universe, padded to a cache line
+        uint32_t               m_maxPeriod;
+        Rule                   m_rule;
+
+        std::vector<word_t>    m_arena;
+        size_t                 m_firstWord;
+        std::vector<Universe>  m_universes;
+        std::vector<uint64_t>  m_hashes;            // Hashes of the last maxPeriod generations of every universe
+        ThreadPool             m_threadPool;
+
+        inline word_t* generationOf(size_t universe, size_t parity)
+        {
+            return m_arena.data() + m_firstWord + (2 * universe + parity) * m_generationWords;
+        }
+        inline word_t const* generationOf(size_t universe, size_t parity) const
+        {
+            return m_arena.data() + m_firstWord + (2 * universe + parity) * m_generationWords;
+        }
+        inline word_t const* cellsOf(size_t universe) const { return generationOf(universe, m_universes[universe].parity); }
+        inline word_t*       cellsOf(size_t universe)       { return generationOf(universe, m_universes[universe].parity); }
+
+        // The states before a change can't be compared with the states after
+        inline void reset(size_t universe)
+        {
+            Universe& state = m_universes[universe];
+            state.isHashed = false;
+            state.period   = 0;
+        }
+        inline void resetAll()
+        {
+            for (size_t universe = 0; universe < m_nbUniverses; universe++)
+                reset(universe);
+        }
+
+        uint64_t hashOf(size_t universe) const;
+        bool recordHash(size_t universe);
+        template<size_t fixedRowWords, typename RuleT>
+        void advanceUniverse(size_t universe, uint64_t generations, RuleT const& rule);
+    };
+
+    inline void BatchEngine::setCellState(size_t universe, size_t x, size_t y, bool isAlive)
+    {
+        word_t& word = cellsOf(universe)[y * m_rowWords + x / bitsPerWord];
+        const word_t mask = word_t(1) << (x % bitsPerWord);
+        word = isAlive ? word | mask : word & ~mask;
+        reset(universe);
+    }
+
+    inline void BatchEngine::clearUniverse(size_t universe)
+    {
+        std::fill(cellsOf(universe), cellsOf(universe) + m_rowWords * m_height, 0);
+        reset(universe);
+    }
+
+    inline void BatchEngine::randomize(size_t universe, uint64_t seed, double density)
+    {
+        // splitmix64, so that the soups don't depend on the standard library
+        auto next = [&seed]()
+        {
+            uint64_t z = (seed += 0x9E3779B97F4A7C15ull);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        };
+        const uint64_t threshold = density >= 1. ? ~uint64_t(0) : static_cast<uint64_t>(density * 18446744073709551616.);
+
+        word_t* cells = cellsOf(universe);
+        for (size_t y = 0; y < m_height; y++)
+            for (size_t i = 0; i < m_rowWords; i++)
+            {
+                word_t word = 0;
+                for (size_t bit = 0; bit < bitsPerWord; bit++)
+                    word |= word_t(next() < threshold) << bit;
+                if (i == m_rowWords - 1)
+                    word &= ~word_t(0) >> (bitsPerWord - 1 - m_lastBit);
+                cells[y * m_rowWords + i] = word;
+            }
+        reset(universe);
+    }
+
+    inline uint64_t BatchEngine::hashOf(size_t universe) const
+    {
+        word_t const* cells = cellsOf(universe);
+        uint64_t hash = 0;
+        for (size_t i = 0; i < m_rowWords * m_height; i++)
+            hash += hashWord(i, cells[i]);
+        return hash;
+    }
+
+    // Returns true once the universe settled : its current state hashes like one of its last maxPeriod states
+    inline bool BatchEngine::recordHash(size_t universe)
+    {
+        Universe& state = m_universes[universe];
+        uint64_t* hashes = m_hashes.data() + universe * m_maxPeriod;
+        if (!state.isHashed)
+            state.hash = hashOf(universe);
+        const uint64_t hash = state.hash;
+
+        if (!state.isHashed)
+        {
+            state.isHashed    = true;
+            state.firstHashed = state.generation;
+        }
+        else
+        {
+            // The shortest period is the one found first
+            const uint64_t nbHashed = std::min<uint64_t>(state.generation - state.firstHashed, m_maxPeriod);
+            for (uint64_t period = 1; period <= nbHashed; period++)
+                if (hashes[(state.generation - period) % m_maxPeriod] == hash)
+                {
+                    state.period                  = static_cast<uint32_t>(period);
+                    state.stabilizationGeneration = state.generation - period;
+                    return true;
+                }
+        }
+        hashes[state.generation % m_maxPeriod] = hash;
+        return false;
+    }
+
+    template<size_t fixedRowWords, typename RuleT>
+    inline void BatchEngine::advanceUniverse(size_t universe, uint64_t generations, RuleT const& rule)
+    {
+        Universe& state = m_universes[universe];
+        if (state.period != 0)
+            return;
+        if (!state.isHashed)
+            recordHash(universe);
+
+        for (uint64_t i = 0; i < generations; i++)
+        {
+            word_t const* cells = generationOf(universe, state.parity);
+            word_t*       next  = generationOf(universe, state.parity ^ 1);
+            uint64_t      hash  = state.hash;
+            for (size_t y = 0; y < m_height; y++)
+            {
+                const size_t topY = y == 0 ? m_height - 1 : y - 1;
+                const size_t botY = y == m_height - 1 ? 0 : y + 1;
+                word_t const* mid = cells + y * m_rowWords;
+                word_t*       out = next  + y * m_rowWords;
+                computeNextWordRow<fixedRowWords>(cells + topY * m_rowWords, mid, cells + botY * m_rowWords,
+                                                  out, m_rowWords, m_lastBit, rule);
+
+                const size_t rowWords = fixedRowWords != 0 ? fixedRowWords : m_rowWords;
+                for (size_t word = 0; word < rowWords; word++)
+                    if (out[word] != mid[word])
+                        hash += hashWord(y * rowWords + word, out[word]) - hashWord(y * rowWords + word, mid[word]);
+            }
+            state.hash = hash;
+            state.parity ^= 1;
+            state.generation++;
+
+            if (recordHash(universe))
+                return;
+        }
+    }
+
+    inline void BatchEngine::advance(uint64_t generations)
+    {
+        // A few tasks per thread, so that those finishing early take the universes of the others
+        const size_t nbTasks = std::min(m_nbUniverses, m_threadPool.size() * 4);
+        dispatchRule(m_rule, [this, generations, nbTasks](auto const& rule)
+        {
+            m_threadPool.parallelFor(nbTasks, [this, generations, nbTasks, &rule](size_t task)
+            {
+                const size_t begin = task * m_nbUniverses / nbTasks;
+                const size_t end   = (task + 1) * m_nbUniverses / nbTasks;
+                for (size_t universe = begin; universe < end; universe++)
+                {
+                    // Universes up to 64 cells wide have a single word per row
+                    if (m_rowWords == 1)
+                        advanceUniverse<1>(universe, generations, rule);
+                    else
+                        advanceUniverse<0>(universe, generations, rule);
+                }
+            });
+        });
+    }
+
+    inline UniverseResult BatchEngine::getResult(size_t universe) const
+    {
+        Universe const& state = m_universes[universe];
+        word_t const* cells = cellsOf(universe);
+
+        uint64_t population = 0;
+        for (size_t i = 0; i < m_rowWords * m_height; i++)
+            population += std::bitset<bitsPerWord>(cells[i]).count();
+
+        return UniverseResult{ population, state.generation, state.period != 0, state.stabilizationGeneration, state.period };
+    }
+}
\ No newline at end of file
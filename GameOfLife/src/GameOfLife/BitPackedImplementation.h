@@ -0,0 +1,530 @@
+#pragma once
+
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+#include <cassert>
+
+#include "Base.h"
+#include "Macros.h"
+
+namespace GameOfLife
+{
+    using word_t = uint64_t;
+    constexpr size_t bitsPerWord = 64;
+
+    template<size_t sideLength>
+    constexpr size_t wordsPerRow = (sideLength + bitsPerWord - 1) / bitsPerWord;
+
+    template<size_t sideLength>
+    using cell_words_t = heap_array<word_t, wordsPerRow<sideLength> * sideLength>;
+
+    // Applies B3/S23 to 64 cells at once, given the 8 neighbor words and the current word.
+    // The neighbors are summed with bit-sliced adders : ones + 2 * twos, fours set when >= 4
+    inline word_t nextWordState(word_t alive,
+                                word_t topLeft, word_t topCenter, word_t topRight,
+                                word_t midLeft,                   word_t midRight,
+                                word_t botLeft, word_t botCenter, word_t botRight)
+    {
+        const word_t sumTop  = topLeft ^ topCenter ^ topRight;
+        const word_t carTop  = (topLeft & topCenter) | (topRight & (topLeft ^ topCenter));
+        const word_t sumBot  = botLeft ^ botCenter ^ botRight;
+        const word_t carBot  = (botLeft & botCenter) | (botRight & (botLeft ^ botCenter));
+        const word_t sumMid  = midLeft ^ midRight;
+        const word_t carMid  = midLeft & midRight;
+
+        const word_t ones    = sumTop ^ sumBot ^ sumMid;
+        const word_t carOnes = (sumTop & sumBot) | (sumMid & (sumTop ^ sumBot));
+
+        const word_t sumTwos = carTop ^ carBot ^ carMid;
+        const word_t carTwos = (carTop & carBot) | (carMid & (carTop ^ carBot));
+        const word_t twos    = sumTwos ^ carOnes;
+        const word_t fours   = carTwos | (sumTwos & carOnes);
+
+        return twos & ~fours & (ones | alive);
+    }
+
+    // Applies any rule to 64 cells at once : the neighbors are summed into the 4 bits of their count,
+    // which is then compared with the counts of the rule. With a StaticRule, the comparisons are unrolled.
+    template<typename RuleT>
+    inline word_t nextWordState(RuleT const& rule, word_t alive,
+                                word_t topLeft, word_t topCenter, word_t topRight,
+                                word_t midLeft,                   word_t midRight,
+                                word_t botLeft, word_t botCenter, word_t botRight)
+    {
+        const word_t sumTop  = topLeft ^ topCenter ^ topRight;
+        const word_t carTop  = (topLeft & topCenter) | (topRight & (topLeft ^ topCenter));
+        const word_t sumBot  = botLeft ^ botCenter ^ botRight;
+        const word_t carBot  = (botLeft & botCenter) | (botRight & (botLeft ^ botCenter));
+        const word_t sumMid  = midLeft ^ midRight;
+        const word_t carMid  = midLeft & midRight;
+
+        const word_t ones    = sumTop ^ sumBot ^ sumMid;
+        const word_t carOnes = (sumTop & sumBot) | (sumMid & (sumTop ^ sumBot));
+
+        const word_t sumTwos = carTop ^ carBot ^ carMid;
+        const word_t carTwos = (carTop & carBot) | (carMid & (carTop ^ carBot));
+        const word_t twos    = sumTwos ^ carOnes;
+        const word_t carFour = sumTwos & carOnes;
+        const word_t fours   = carTwos ^ carFour;
+        const word_t eights  = carTwos & carFour;
+
+        word_t born    = 0;
+        word_t survive = 0;
+        for (int n = 0; n <= 8; n++)
+        {
+            if ((((rule.birth | rule.survival) >> n) & 1) == 0)
+                continue;
+            const word_t count = (n & 1 ? ones : ~ones) & (n & 2 ? twos : ~twos)
+                               & (n & 4 ? fours : ~fours) & (n & 8 ? eights : ~eights);
+            if ((rule.birth >> n) & 1)
+                born |= count;
+            if ((rule.survival >> n) & 1)
+                survive |= count;
+        }
+        return (born & ~alive) | (survive & alive);
+    }
+
+    inline word_t nextWordState(ConwayRule const&, word_t alive,
+                                word_t topLeft, word_t topCenter, word_t topRight,
+                                word_t midLeft,                   word_t midRight,
+                                word_t botLeft, word_t botCenter, word_t botRight)
+    {
+        return nextWordState(alive, topLeft, topCenter, topRight, midLeft, midRight, botLeft, botCenter, botRight);
+    }
+
+    // Cells shifted so that bit b holds the state of the cell x - 1 (left) or x + 1 (right),
+    // lastBit being the position of the last cell of the row in its last word
+    inline word_t leftNeighborsWord(word_t const* row, size_t i, size_t rowWords, size_t lastBit)
+    {
+        if (i == 0)
+            return (row[0] << 1) | ((row[rowWords - 1] >> lastBit) & 1);
+        return (row[i] << 1) | (row[i - 1] >> (bitsPerWord - 1));
+    }
+
+    inline word_t rightNeighborsWord(word_t const* row, size_t i, size_t rowWords, size_t lastBit)
+    {
+        if (i == rowWords - 1)
+            return (row[i] >> 1) | ((row[0] & 1) << lastBit);
+        return (row[i] >> 1) | (row[i + 1] << (bitsPerWord - 1));
+    }
+
+    template<typename RuleT>
+    inline word_t nextWordAt(word_t const* top, word_t const* mid, word_t const* bot,
+                             size_t i, size_t rowWords, size_t lastBit, RuleT const& rule)
+    {
+        return nextWordState(rule, mid[i],
+                             leftNeighborsWord(top, i, rowWords, lastBit), top[i], rightNeighborsWord(top, i, rowWords, lastBit),
+                             leftNeighborsWord(mid, i, rowWords, lastBit),         rightNeighborsWord(mid, i, rowWords, lastBit),
+                             leftNeighborsWord(bot, i, rowWords, lastBit), bot[i], rightNeighborsWord(bot, i, rowWords, lastBit));
+    }
+
+    // Builds the next states of a row of words from the rows above and below.
+    // A non-zero fixedRowWords replaces rowWords by a compile-time constant, so that the loop can be unrolled.
+    template<size_t fixedRowWords, typename RuleT = ConwayRule>
+    inline void computeNextWordRow(word_t const* top, word_t const* mid, word_t const* bot, word_t* out,
+                                   size_t rowWords, size_t lastBit, RuleT const& rule = RuleT())
+    {
+        if (fixedRowWords != 0)
+            rowWords = fixedRowWords;
+
+        // The first and last words wrap around the row, the ones in between don't
+        out[0] = nextWordAt(top, mid, bot, 0, rowWords, lastBit, rule);
+        for (size_t i = 1; i + 1 < rowWords; i++)
+        {
+            out[i] = nextWordState(rule, mid[i],
+                                   (top[i] << 1) | (top[i - 1] >> 63), top[i], (top[i] >> 1) | (top[i + 1] << 63),
+                                   (mid[i] << 1) | (mid[i - 1] >> 63),         (mid[i] >> 1) | (mid[i + 1] << 63),
+                                   (bot[i] << 1) | (bot[i - 1] >> 63), bot[i], (bot[i] >> 1) | (bot[i + 1] << 63));
+        }
+        if (rowWords > 1)
+            out[rowWords - 1] = nextWordAt(top, mid, bot, rowWords - 1, rowWords, lastBit, rule);
+
+        out[rowWords - 1] &= ~word_t(0) >> (bitsPerWord - 1 - lastBit);
+    }
+
+    // Number of alive cells of a row of words in [xBegin, xEnd)
+    inline size_t countAliveInRow(word_t const* row, size_t xBegin, size_t xEnd)
+    {
+        size_t nbAlive = 0;
+        for (size_t x = xBegin; x < xEnd;)
+        {
+            const size_t bit    = x % bitsPerWord;
+            const size_t nbBits = std::min(bitsPerWord - bit, xEnd - x);
+            const word_t mask   = (nbBits == bitsPerWord ? ~word_t(0) : (word_t(1) << nbBits) - 1) << bit;
+            nbAlive += std::bitset<bitsPerWord>(row[x / bitsPerWord] & mask).count();
+            x += nbBits;
+        }
+        return nbAlive;
+    }
+
+    // Overwrites the bits [x, x + nbCells) of row with those of words, whole words at a time
+    inline void copyBitsToRow(word_t* row, size_t x, word_t const* words, size_t nbCells)
+    {
+        const size_t shift = x % bitsPerWord;
+        word_t* out = row + x / bitsPerWord;
+        for (size_t i = 0; i * bitsPerWord < nbCells; i++)
+        {
+            const size_t nbBits = std::min(bitsPerWord, nbCells - i * bitsPerWord);
+            const word_t mask   = nbBits == bitsPerWord ? ~word_t(0) : (word_t(1) << nbBits) - 1;
+            const word_t bits   = words[i] & mask;
+
+            out[i] = (out[i] & ~(mask << shift)) | (bits << shift);
+            if (shift != 0 && (mask >> (bitsPerWord - shift)) != 0)
+                out[i + 1] = (out[i + 1] & ~(mask >> (bitsPerWord - shift))) | (bits >> (bitsPerWord - shift));
+        }
+    }
+
+    // Reads the bits [x, x + nbCells) of row into words, whole words at a time
+    inline void copyBitsFromRow(word_t const* row, size_t x, word_t* words, size_t nbCells)
+    {
+        const size_t shift = x % bitsPerWord;
+        word_t const* in = row + x / bitsPerWord;
+        for (size_t i = 0; i * bitsPerWord < nbCells; i++)
+        {
+            const size_t nbBits = std::min(bitsPerWord, nbCells - i * bitsPerWord);
+            const word_t mask   = nbBits == bitsPerWord ? ~word_t(0) : (word_t(1) << nbBits) - 1;
+
+            word_t bits = in[i] >> shift;
+            if (shift != 0 && nbBits > bitsPerWord - shift)
+                bits |= in[i + 1] << (bitsPerWord - shift);
+            words[i] = bits & mask;
+        }
+    }
+
+    // ------------------ BIT PACKED ENGINE --------------------//
+    // Stores 64 cells per word, bit b of word i of a row being the cell x = 64 * i + b.
+    // The padding bits of the last word of each row are always kept at 0.
+    template<size_t sideLength>
+    class BitPackedEngine : public IEngine
+    {
+    public:
+        static constexpr size_t rowWords = wordsPerRow<sideLength>;
+        static constexpr size_t lastBit  = (sideLength - 1) % bitsPerWord;
+
+        BitPackedEngine()
+            : m_cellWords(cell_words_t<sideLength>()),
+            m_nextCellWords(cell_words_t<sideLength>()),
+            m_changes(sideLength, sideLength), m_trackChanges(false) {}
+        BitPackedEngine(cell_states_t<sideLength> const& initial_states)
+            : m_cellWords(cell_words_t<sideLength>()),
+            m_nextCellWords(cell_words_t<sideLength>()),
+            m_changes(sideLength, sideLength), m_trackChanges(false)
+        {
+            for (size_t y = 0; y < sideLength; y++)
+                for (size_t x = 0; x < sideLength; x++)
+                    if (initial_states[x + y * sideLength])
+                        m_cellWords[y * rowWords + x / bitsPerWord] |= word_t(1) << (x % bitsPerWord);
+        }
+
+        inline cell_words_t<sideLength> const& getCellWords() const { return m_cellWords; }
+        size_t getWidth() const override  { return sideLength; }
+        size_t getHeight() const override { return sideLength; }
+        inline bool getCellState(size_t x, size_t y) const
+        {
+            return (m_cellWords[y * rowWords + x / bitsPerWord] >> (x % bitsPerWord)) & 1;
+        }
+
+        void setCellState(size_t x, size_t y, bool isAlive) override;
+        void clearCells() override
+        {
+            m_cellWords.fill(0);
+            m_changes.markAll();
+        }
+        void getRowCells(size_t x, size_t y, uint64_t* words, size_t nbCells) const override
+        {
+            copyBitsFromRow(m_cellWords.get() + y * rowWords, x, words, nbCells);
+        }
+        void setRowCells(size_t x, size_t y, uint64_t const* words, size_t nbCells) override
+        {
+            copyBitsToRow(m_cellWords.get() + y * rowWords, x, words, nbCells);
+            m_changes.markRect(Rect{ x, y, nbCells, 1 });
+        }
+        void computeNextGeneration() override;
+
+        bool setRule(Rule const& rule) override { m_rule = rule; return true; }
+        Rule getRule() const override           { return m_rule; }
+
+        void setChangeTracking(bool enabled) override
+        {
+            m_trackChanges = enabled;
+            m_changes.markAll();
+        }
+        bool collectChanges(ChangeSet& changes) override
+        {
+            if (!m_trackChanges)
+                return false;
+            changes.merge(m_changes);
+            m_changes.clear();
+            return true;
+        }
+
+    private:
+        cell_words_t<sideLength> m_cellWords;
+        cell_words_t<sideLength> m_nextCellWords;
+        ChangeSet                m_changes;
+        bool                     m_trackChanges;
+        Rule                     m_rule;
+
+        template<typename RuleT>
+        void computeRows(RuleT const& rule);
+    };
+
+    template<size_t sideLength>
+    void BitPackedEngine<sideLength>::setCellState(size_t x, size_t y, bool isAlive)
+    {
+        word_t& word = m_cellWords[y * rowWords + x / bitsPerWord];
+        const word_t mask = word_t(1) << (x % bitsPerWord);
+        if (isAlive)
+            word |= mask;
+        else
+            word &= ~mask;
+        m_changes.markCell(x, y);
+    }
+
+    template<size_t sideLength>
+    void BitPackedEngine<sideLength>::computeNextGeneration()
+    {
+        dispatchRule(m_rule, [this](auto const& rule) { computeRows(rule); });
+
+        // Makes the new generation the current generation
+        std::swap(m_cellWords, m_nextCellWords);
+    }
+
+    template<size_t sideLength>
+    template<typename RuleT>
+    void BitPackedEngine<sideLength>::computeRows(RuleT const& rule)
+    {
+        word_t const* cells = m_cellWords.get();
+        word_t*       next  = m_nextCellWords.get();
+
+        // Builds the next states on m_nextCellWords, one row of words at a time
+        for (size_t y = 0; y < sideLength; y++)
+        {
+            const size_t topY = y == 0 ? sideLength - 1 : y - 1;
+            const size_t botY = y == sideLength - 1 ? 0 : y + 1;
+
+            word_t const* top = cells + topY * rowWords;
+            word_t const* mid = cells + y    * rowWords;
+            word_t const* bot = cells + botY * rowWords;
+            word_t*       out = next  + y    * rowWords;
+
+            computeNextWordRow<rowWords>(top, mid, bot, out, rowWords, lastBit, rule);
+            if (m_trackChanges)
+                m_changes.markRow(y, mid, out);
+        }
+    }
+
+
+
+    // ------------------- BIT PACKED VIEW ---------------------//
+    template<size_t sideLength>
+    class BitPackedView : public IView
+    {
+    public:
+        using EngineType = BitPackedEngine<sideLength>;
+
+        BitPackedView(EngineType& engine)
+            : m_engine(engine) {}
+
+        void computeColors(Viewport const& viewport, uint8_t* pixels) const override;
+        void updateColors(Viewport const& viewport, ChangeSet const& changes, uint8_t* pixels) const override;
+
+    private:
+        EngineType& m_engine;
+
+        inline size_t countAlive(size_t y, size_t xBegin, size_t xEnd) const
+        {
+            return countAliveInRow(m_engine.getCellWords().get() + y * EngineType::rowWords, xBegin, xEnd);
+        }
+    };
+
+    template<size_t sideLength>
+    void BitPackedView<sideLength>::computeColors(Viewport const& viewport, uint8_t* pixels) const
+    {
+        colorViewport(viewport, pixels, [this](size_t y, size_t xBegin, size_t xEnd) { return countAlive(y, xBegin, xEnd); });
+    }
+
+    template<size_t sideLength>
+    void BitPackedView<sideLength>::updateColors(Viewport const& viewport, ChangeSet const& changes, uint8_t* pixels) const
+    {
+        colorChangedPixels(viewport, changes, pixels, [this](size_t y, size_t xBegin, size_t xEnd) { return countAlive(y, xBegin, xEnd); });
+    }
+
+
+
+    // --------------- RUNTIME BIT PACKED ENGINE ---------------//
+    // Same layout as BitPackedEngine for a width x height torus only known at runtime.
+    // Rows are padded to whole cache lines, plus one more line when the pitch is a multiple of 4 KiB
+    // so that the three rows read together don't map to the same cache sets.
+    class RuntimeBitPackedEngine : public IEngine
+    {
+    public:
+        static constexpr size_t cacheLineWords = 64 / sizeof(word_t);
+
+        RuntimeBitPackedEngine(size_t width, size_t height)
+            : m_width(width), m_height(height),
+              m_rowWords((width + bitsPerWord - 1) / bitsPerWord),
+              m_pitch(computePitch(m_rowWords)),
+              m_lastBit((width - 1) % bitsPerWord),
+              m_cellWords(m_pitch * height),
+              m_nextCellWords(m_pitch * height),
+              m_changes(width, height), m_trackChanges(false)
+        {
+            assert(width > 0 && height > 0);
+        }
+
+        size_t getWidth() const override  { return m_width; }
+        size_t getHeight() const override { return m_height; }
+
+        // Row y starts at getCellWords() + y * getPitch()
+        inline word_t const* getCellWords() const { return m_cellWords.get(); }
+        inline size_t getPitch() const            { return m_pitch; }
+        inline size_t getRowWords() const         { return m_rowWords; }
+        inline bool getCellState(size_t x, size_t y) const
+        {
+            return (m_cellWords[y * m_pitch + x / bitsPerWord] >> (x % bitsPerWord)) & 1;
+        }
+
+        void setCellState(size_t x, size_t y, bool isAlive) override;
+        void clearCells() override
+        {
+            m_cellWords.fill(0);
+            m_changes.markAll();
+        }
+        void getRowCells(size_t x, size_t y, uint64_t* words, size_t nbCells) const override
+        {
+            copyBitsFromRow(m_cellWords.get() + y * m_pitch, x, words, nbCells);
+        }
+        void setRowCells(size_t x, size_t y, uint64_t const* words, size_t nbCells) override
+        {
+            copyBitsToRow(m_cellWords.get() + y * m_pitch, x, words, nbCells);
+            m_changes.markRect(Rect{ x, y, nbCells, 1 });
+        }
+        void computeNextGeneration() override;
+
+        bool setRule(Rule const& rule) override { m_rule = rule; return true; }
+        Rule getRule() const override           { return m_rule; }
+
+        void setChangeTracking(bool enabled) override
+        {
+            m_trackChanges = enabled;
+            m_changes.markAll();
+        }
+        bool collectChanges(ChangeSet& changes) override
+        {
+            if (!m_trackChanges)
+                return false;
+            changes.merge(m_changes);
+            m_changes.clear();
+            return true;
+        }
+
+    private:
+        size_t m_width;
+        size_t m_height;
+        size_t m_rowWords;
+        size_t m_pitch;
+        size_t m_lastBit;
+        aligned_heap_array<word_t> m_cellWords;
+        aligned_heap_array<word_t> m_nextCellWords;
+        ChangeSet m_changes;
+        bool      m_trackChanges;
+        Rule      m_rule;
+
+        static inline size_t computePitch(size_t rowWords)
+        {
+            size_t pitch = (rowWords + cacheLineWords - 1) / cacheLineWords * cacheLineWords;
+            if ((pitch * sizeof(word_t)) % 4096 == 0)
+                pitch += cacheLineWords;
+            return pitch;
+        }
+
+        template<size_t fixedRowWords, typename RuleT>
+        void computeRows(RuleT const& rule);
+    };
+
+    inline void RuntimeBitPackedEngine::setCellState(size_t x, size_t y, bool isAlive)
+    {
+        word_t& word = m_cellWords[y * m_pitch + x / bitsPerWord];
+        const word_t mask = word_t(1) << (x % bitsPerWord);
+        if (isAlive)
+            word |= mask;
+        else
+            word &= ~mask;
+        m_changes.markCell(x, y);
+    }
+
+    template<size_t fixedRowWords, typename RuleT>
+    void RuntimeBitPackedEngine::computeRows(RuleT const& rule)
+    {
+        word_t const* cells = m_cellWords.get();
+        word_t*       next  = m_nextCellWords.get();
+
+        for (size_t y = 0; y < m_height; y++)
+        {
+            const size_t topY = y == 0 ? m_height - 1 : y - 1;
+            const size_t botY = y == m_height - 1 ? 0 : y + 1;
+
+            computeNextWordRow<fixedRowWords>(cells + topY * m_pitch, cells + y * m_pitch, cells + botY * m_pitch,
+                                              next + y * m_pitch, m_rowWords, m_lastBit, rule);
+            if (m_trackChanges)
+                m_changes.markRow(y, cells + y * m_pitch, next + y * m_pitch);
+        }
+    }
+
+    inline void RuntimeBitPackedEngine::computeNextGeneration()
+    {
+        // Builds the next states on m_nextCellWords, common power of two widths having their own kernel
+        dispatchRule(m_rule, [this](auto const& rule)
+        {
+            switch (m_rowWords)
+            {
+                case 1:  computeRows<1>(rule);  break;
+                case 2:  computeRows<2>(rule);  break;
+                case 4:  computeRows<4>(rule);  break;
+                case 8:  computeRows<8>(rule);  break;
+                case 16: computeRows<16>(rule); break;
+                case 32: computeRows<32>(rule); break;
+                case 64: computeRows<64>(rule); break;
+                default: computeRows<0>(rule);  break;
+            }
+        });
+
+        // Makes the new generation the current generation
+        std::swap(m_cellWords, m_nextCellWords);
+    }
+
+
+
+    // --------------- RUNTIME BIT PACKED VIEW -----------------//
+    class RuntimeBitPackedView : public IView
+    {
+    public:
+        using EngineType = RuntimeBitPackedEngine;
+
+        RuntimeBitPackedView(EngineType& engine)
+            : m_engine(engine) {}
+
+        void computeColors(Viewport const& viewport, uint8_t* pixels) const override;
+        void updateColors(Viewport const& viewport, ChangeSet const& changes, uint8_t* pixels) const override;
+
+    private:
+        EngineType& m_engine;
+
+        inline size_t countAlive(size_t y, size_t xBegin, size_t xEnd) const
+        {
+            return countAliveInRow(m_engine.getCellWords() + y * m_engine.getPitch(), xBegin, xEnd);
+        }
+    };
+
+    inline void RuntimeBitPackedView::computeColors(Viewport const& viewport, uint8_t* pixels) const
+    {
+        colorViewport(viewport, pixels, [this](size_t y, size_t xBegin, size_t xEnd) { return countAlive(y, xBegin, xEnd); });
+    }
+
+    inline void RuntimeBitPackedView::updateColors(Viewport const& viewport, ChangeSet const& changes, uint8_t* pixels) const
+    {
+        colorChangedPixels(viewport, changes, pixels, [this](size_t y, size_t xBegin, size_t xEnd) { return countAlive(y, xBegin, xEnd); });
+    }
+}
\ No newline at end of file
@@ -1,34 +1,84 @@
 #pragma once
 
 #include <cassert>
+#include <algorithm>
 
 #include "Base.h"
 #include "Macros.h"
+#include "ThreadPool.h"
 
 namespace GameOfLife
 {
 
     // --------------------- CPU ENGINE -----------------------//
     template<size_t sideLength>
-    class CPUEngine : public IEngine<sideLength>
+    class CPUEngine : public IEngine
     {
     public:
         CPUEngine()
             : m_cellStates(cell_states_t<sideLength>()),
-            m_nextCellStates(cell_states_t<sideLength>()) {}
+            m_nextCellStates(cell_states_t<sideLength>()),
+            m_changes(sideLength, sideLength), m_trackChanges(false) {}
         CPUEngine(cell_states_t<sideLength>&& initial_states)
             : m_cellStates(std::move(initial_states)),
-            m_nextCellStates(cell_states_t<sideLength>()) {}
+            m_nextCellStates(cell_states_t<sideLength>()),
+            m_changes(sideLength, sideLength), m_trackChanges(false) {}
 
         inline cell_states_t<sideLength> const& getCellStates() const { return m_cellStates; }
+        size_t getWidth() const override  { return sideLength; }
+        size_t getHeight() const override { return sideLength; }
 
-        void setCellState(size_t x, size_t y, bool isAlive) override { m_cellStates[x + y * sideLength] = isAlive; }
-        void clearCells() override { m_cellStates.fill(false); }
+        void setCellState(size_t x, size_t y, bool isAlive) override
+        {
+            m_cellStates[x + y * sideLength] = isAlive;
+            m_changes.markCell(x, y);
+        }
+        void clearCells() override
+        {
+            m_cellStates.fill(false);
+            m_changes.markAll();
+        }
+        void getRowCells(size_t x, size_t y, uint64_t* words, size_t nbCells) const override
+        {
+            bool const* row = m_cellStates.get() + x + y * sideLength;
+            std::fill(words, words + (nbCells + 63) / 64, 0);
+            for (size_t i = 0; i < nbCells; i++)
+                words[i / 64] |= uint64_t(row[i]) << (i % 64);
+        }
+        void setRowCells(size_t x, size_t y, uint64_t const* words, size_t nbCells) override
+        {
+            bool* row = m_cellStates.get() + x + y * sideLength;
+            for (size_t i = 0; i < nbCells; i++)
+                row[i] = (words[i / 64] >> (i % 64)) & 1;
+            m_changes.markRect(Rect{ x, y, nbCells, 1 });
+        }
         void computeNextGeneration() override;
 
-    private:
+        bool setRule(Rule const& rule) override { m_rule = rule; return true; }
+        Rule getRule() const override           { return m_rule; }
+
+        void setChangeTracking(bool enabled) override
+        {
+            m_trackChanges = enabled;
+            m_changes.markAll();
+        }
+        bool collectChanges(ChangeSet& changes) override;
+
+    protected:
         cell_states_t<sideLength> m_cellStates;
         cell_states_t<sideLength> m_nextCellStates;
+        ChangeSet                 m_changes;
+        bool                      m_trackChanges;
+        Rule                      m_rule;
+
+        // Builds the next states of the cells in [begin, end) on m_nextCellStates
+        void computeCellRange(size_t begin, size_t end);
+        template<typename RuleT>
+        void computeCellRange(size_t begin, size_t end, RuleT const& rule);
+        // Marks the tiles of the rows [firstRow, lastRow) whose cells differ between m_cellStates and m_nextCellStates
+        void markChangedRows(size_t firstRow, size_t lastRow);
+
+    private:
 
         inline bool topLeftNeighborIndex(size_t index)
         {
@@ -136,7 +186,44 @@ namespace GameOfLife
     void CPUEngine<sideLength>::computeNextGeneration()
     {
         // Builds the next states on m_nextCellStates
-        for (size_t curIndex = 0; curIndex < m_cellStates.size(); curIndex++)
+        computeCellRange(0, m_cellStates.size());
+        if (m_trackChanges)
+            markChangedRows(0, sideLength);
+
+        // Makes the new generation the current generation
+        std::swap(m_cellStates, m_nextCellStates);
+    }
+
+    template<size_t sideLength>
+    bool CPUEngine<sideLength>::collectChanges(ChangeSet& changes)
+    {
+        if (!m_trackChanges)
+            return false;
+        changes.merge(m_changes);
+        m_changes.clear();
+        return true;
+    }
+
+    template<size_t sideLength>
+    void CPUEngine<sideLength>::markChangedRows(size_t firstRow, size_t lastRow)
+    {
+        uint8_t const* cells = reinterpret_cast<uint8_t const*>(m_cellStates.get());
+        uint8_t const* next  = reinterpret_cast<uint8_t const*>(m_nextCellStates.get());
+        for (size_t y = firstRow; y < lastRow; y++)
+            m_changes.markRow(y, cells + y * sideLength, next + y * sideLength);
+    }
+
+    template<size_t sideLength>
+    void CPUEngine<sideLength>::computeCellRange(size_t begin, size_t end)
+    {
+        dispatchRule(m_rule, [this, begin, end](auto const& rule) { computeCellRange(begin, end, rule); });
+    }
+
+    template<size_t sideLength>
+    template<typename RuleT>
+    void CPUEngine<sideLength>::computeCellRange(size_t begin, size_t end, RuleT const& rule)
+    {
+        for (size_t curIndex = begin; curIndex < end; curIndex++)
         {
             bool topLeft   = topLeftNeighborIndex(curIndex);
             bool topCenter = topCenterNeighborState(curIndex);
@@ -151,54 +238,97 @@ namespace GameOfLife
                             + midLeft             + midRight
                             + botLeft + botCenter + botRight;
 
-            switch (nbNeighbors)
-            {
-                case 2:  m_nextCellStates[curIndex] = m_cellStates[curIndex]; break;
-                case 3:  m_nextCellStates[curIndex] = true;                   break;
-                default: m_nextCellStates[curIndex] = false;                  break;
-            }
+            m_nextCellStates[curIndex] = rule.nextState(m_cellStates[curIndex], nbNeighbors);
         }
+    }
+
+
+
+    // ----------------- PARALLEL CPU ENGINE -------------------//
+    // Same computation as CPUEngine, with the torus split into horizontal bands
+    // that are computed by a persistent thread pool.
+    template<size_t sideLength>
+    class ParallelCPUEngine : public CPUEngine<sideLength>
+    {
+    public:
+        ParallelCPUEngine(size_t nbThreads = ThreadPool::defaultThreadCount())
+            : CPUEngine<sideLength>(), m_threadPool(nbThreads) {}
+        ParallelCPUEngine(cell_states_t<sideLength>&& initial_states, size_t nbThreads = ThreadPool::defaultThreadCount())
+            : CPUEngine<sideLength>(std::move(initial_states)), m_threadPool(nbThreads) {}
+
+        void computeNextGeneration() override;
+
+    private:
+        ThreadPool m_threadPool;
+    };
+
+    template<size_t sideLength>
+    void ParallelCPUEngine<sideLength>::computeNextGeneration()
+    {
+        const size_t nbBands = std::min(m_threadPool.size(), sideLength);
+
+        // Every band builds its rows on m_nextCellStates, parallelFor() returning once they are all done
+        m_threadPool.parallelFor(nbBands, [this, nbBands](size_t band)
+        {
+            const size_t firstRow = band * sideLength / nbBands;
+            const size_t lastRow  = (band + 1) * sideLength / nbBands;
+            this->computeCellRange(firstRow * sideLength, lastRow * sideLength);
+        });
 
+        // The bands don't match the rows of tiles, which are marked by a second pass
+        if (this->m_trackChanges)
+        {
+            m_threadPool.parallelFor(this->m_changes.getTileRows(), [this](size_t tileY)
+            {
+                const size_t firstRow = tileY * ChangeSet::tileSize;
+                this->markChangedRows(firstRow, std::min(firstRow + ChangeSet::tileSize, sideLength));
+            });
+        }
 
         // Makes the new generation the current generation
-        std::swap(m_cellStates, m_nextCellStates);
+        std::swap(this->m_cellStates, this->m_nextCellStates);
     }
-    
-    
+
+
+
 
     // ---------------------- CPU VIEW -------------------------//
     template<size_t sideLength>
-    class CPUView : public IView<sideLength>
+    class CPUView : public IView
     {
     public:
         using EngineType = CPUEngine<sideLength>;
 
         CPUView(EngineType& engine)
-            : m_engine(engine),
-            m_cellColors(cell_colors_t<sideLength>()) {}
+            : m_engine(engine) {}
 
-        cell_colors_t<sideLength> const& computeColors() const override;
+        void computeColors(Viewport const& viewport, uint8_t* pixels) const override;
+        void updateColors(Viewport const& viewport, ChangeSet const& changes, uint8_t* pixels) const override;
 
     private:
         EngineType& m_engine;
-        mutable cell_colors_t<sideLength> m_cellColors;
 
         inline cell_states_t<sideLength> const& getCellStates() const { return m_engine.getCellStates(); }
+
+        inline size_t countAlive(size_t y, size_t xBegin, size_t xEnd) const
+        {
+            cell_states_t<sideLength> const& states = getCellStates();
+            size_t nbAlive = 0;
+            for (size_t x = xBegin; x < xEnd; x++)
+                nbAlive += states[x + y * sideLength];
+            return nbAlive;
+        }
     };
 
     template<size_t sideLength>
-    cell_colors_t<sideLength> const& CPUView<sideLength>::computeColors() const
+    void CPUView<sideLength>::computeColors(Viewport const& viewport, uint8_t* pixels) const
     {
-        cell_states_t<sideLength> const& states = getCellStates();
-        for (size_t i = 0; i < states.size(); i++)
-        {
-            const size_t index = 4 * i;
-            const uint8_t color = states[i] * 200;
-            m_cellColors[index + 0] = 10;
-            m_cellColors[index + 1] = color;
-            m_cellColors[index + 2] = color;
-            m_cellColors[index + 3] = 255;
-        }
-        return m_cellColors;
+        colorViewport(viewport, pixels, [this](size_t y, size_t xBegin, size_t xEnd) { return countAlive(y, xBegin, xEnd); });
+    }
+
+    template<size_t sideLength>
+    void CPUView<sideLength>::updateColors(Viewport const& viewport, ChangeSet const& changes, uint8_t* pixels) const
+    {
+        colorChangedPixels(viewport, changes, pixels, [this](size_t y, size_t xBegin, size_t xEnd) { return countAlive(y, xBegin, xEnd); });
     }
 }
\ No newline at end of file
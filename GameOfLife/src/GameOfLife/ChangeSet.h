@@ -0,0 +1,178 @@
+#pragma once
+
+#include <algorithm>
+#include <bitset>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "Viewport.h"
+
+namespace GameOfLife
+{
+    // Tiles of tileSize x tileSize cells whose state changed, one bit per tile.
+    // Every row of tiles starts on its own word, so rows of tiles may be marked from different threads.
+    class ChangeSet final
+    {
+    public:
+        static constexpr size_t tileSize     = 64;
+        static constexpr size_t tilesPerWord = 64;
+
+        ChangeSet() : ChangeSet(0, 0) {}
+        ChangeSet(size_t width, size_t height)
+            : m_width(width), m_height(height),
+              m_tilesPerRow((width + tileSize - 1) / tileSize),
+              m_tileRows((height + tileSize - 1) / tileSize),
+              m_rowWords((m_tilesPerRow + tilesPerWord - 1) / tilesPerWord),
+              m_tiles(m_rowWords * m_tileRows, 0) {}
+
+        inline size_t getWidth() const       { return m_width; }
+        inline size_t getHeight() const      { return m_height; }
+        inline size_t getTilesPerRow() const { return m_tilesPerRow; }
+        inline size_t getTileRows() const    { return m_tileRows; }
+
+        inline bool isTileChanged(size_t tileX, size_t tileY) const
+        {
+            return (m_tiles[tileY * m_rowWords + tileX / tilesPerWord] >> (tileX % tilesPerWord)) & 1;
+        }
+        inline void markTile(size_t tileX, size_t tileY)
+        {
+            m_tiles[tileY * m_rowWords + tileX / tilesPerWord] |= uint64_t(1) << (tileX % tilesPerWord);
+        }
+        inline void markCell(size_t x, size_t y) { markTile(x / tileSize, y / tileSize); }
+
+        void markRect(Rect const& cells);
+        void markAll();
+        inline void clear() { std::fill(m_tiles.begin(), m_tiles.end(), 0); }
+        bool isEmpty() const;
+        size_t countTiles() const;
+        void merge(ChangeSet const& other);
+
+        // Marks the tiles of the row y whose cells differ between before and after, one byte per cell
+        void markRow(size_t y, uint8_t const* before, uint8_t const* after);
+        // Same with 64 cells per word, a word being exactly one tile wide
+        void markRow(size_t y, uint64_t const* before, uint64_t const* after);
+
+        // Calls f(Rect const& cells) on rectangles covering the changed tiles, clipped to the grid.
+        // Runs of changed tiles are reported together, as well as rows of tiles that changed the same way.
+        template<typename F>
+        void forEachRect(F&& f) const;
+
+    private:
+        size_t                m_width;
+        size_t                m_height;
+        size_t                m_tilesPerRow;
+        size_t                m_tileRows;
+        size_t                m_rowWords;
+        std::vector<uint64_t> m_tiles;
+    };
+
+    inline void ChangeSet::markRect(Rect const& cells)
+    {
+        if (cells.width == 0 || cells.height == 0)
+            return;
+        for (size_t tileY = cells.y / tileSize; tileY <= (cells.y + cells.height - 1) / tileSize; tileY++)
+            for (size_t tileX = cells.x / tileSize; tileX <= (cells.x + cells.width - 1) / tileSize; tileX++)
+                markTile(tileX, tileY);
+    }
+
+    inline void ChangeSet::markAll()
+    {
+        // The bits past the last tile of each row stay at 0
+        for (size_t tileY = 0; tileY < m_tileRows; tileY++)
+            for (size_t word = 0; word < m_rowWords; word++)
+            {
+                const size_t nbTiles = std::min(tilesPerWord, m_tilesPerRow - word * tilesPerWord);
+                m_tiles[tileY * m_rowWords + word] = nbTiles == tilesPerWord ? ~uint64_t(0) : (uint64_t(1) << nbTiles) - 1;
+            }
+    }
+
+    inline bool ChangeSet::isEmpty() const
+    {
+        return std::all_of(m_tiles.begin(), m_tiles.end(), [](uint64_t word) { return word == 0; });
+    }
+
+    inline size_t ChangeSet::countTiles() const
+    {
+        size_t nbTiles = 0;
+        for (uint64_t word : m_tiles)
+            nbTiles += std::bitset<tilesPerWord>(word).count();
+        return nbTiles;
+    }
+
+    inline void ChangeSet::merge(ChangeSet const& other)
+    {
+        assert(other.m_width == m_width && other.m_height == m_height);
+        for (size_t i = 0; i < m_tiles.size(); i++)
+            m_tiles[i] |= other.m_tiles[i];
+    }
+
+    inline void ChangeSet::markRow(size_t y, uint8_t const* before, uint8_t const* after)
+    {
+        const size_t tileY = y / tileSize;
+        for (size_t tileX = 0; tileX < m_tilesPerRow; tileX++)
+        {
+            if (isTileChanged(tileX, tileY))
+                continue;
+            const size_t firstX = tileX * tileSize;
+            const size_t nbCells = std::min(tileSize, m_width - firstX);
+            if (std::memcmp(before + firstX, after + firstX, nbCells) != 0)
+                markTile(tileX, tileY);
+        }
+    }
+
+    inline void ChangeSet::markRow(size_t y, uint64_t const* before, uint64_t const* after)
+    {
+        static_assert(tileSize == 64, "one word per tile");
+
+        const size_t tileY = y / tileSize;
+        for (size_t tileX = 0; tileX < m_tilesPerRow; tileX++)
+            if (before[tileX] != after[tileX])
+                markTile(tileX, tileY);
+    }
+
+    template<typename F>
+    void ChangeSet::forEachRect(F&& f) const
+    {
+        for (size_t tileY = 0; tileY < m_tileRows;)
+        {
+            uint64_t const* row = m_tiles.data() + tileY * m_rowWords;
+
+            size_t endY = tileY + 1;
+            while (endY < m_tileRows && std::equal(row, row + m_rowWords, m_tiles.data() + endY * m_rowWords))
+                endY++;
+
+            for (size_t tileX = 0; tileX < m_tilesPerRow;)
+            {
+                if (!isTileChanged(tileX, tileY))
+                {
+                    tileX++;
+                    continue;
+                }
+
+                size_t endX = tileX + 1;
+                while (endX < m_tilesPerRow && isTileChanged(endX, tileY))
+                    endX++;
+
+                const size_t x = tileX * tileSize;
+                const size_t y = tileY * tileSize;
+                f(Rect{ x, y, std::min(endX * tileSize, m_width) - x, std::min(endY * tileSize, m_height) - y });
+                tileX = endX;
+            }
+            tileY = endY;
+        }
+    }
+
+    // Recolors the pixels of the viewport covering the changed cells, see colorPixels()
+    template<typename CountAlive>
+    void colorChangedPixels(Viewport const& viewport, ChangeSet const& changes, uint8_t* pixels, CountAlive&& countAlive)
+    {
+        changes.forEachRect([&](Rect const& cells)
+        {
+            Rect pixelRect;
+            if (viewport.getPixelRect(cells, pixelRect))
+                colorPixels(viewport, pixelRect, pixels, countAlive);
+        });
+    }
+}
\ No newline at end of file
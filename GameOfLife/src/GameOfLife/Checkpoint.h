@@ -0,0 +1,449 @@
+#pragma once
+
+#include <algorithm>
+#include <bitset>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#include "Base.h"
+
+namespace GameOfLife
+{
+    // Checkpoint files are made of, in little endian :
+    //  - a CheckpointHeader
+    //  - the encoded size of every tile of 64x64 cells as a uint32_t, row of tiles after row of tiles, 0 for the empty ones
+    //  - the encoded non empty tiles : a uint64_t mask of their non empty rows, followed by these rows, one uint64_t each
+    struct CheckpointHeader
+    {
+        char     magic[8];
+        uint32_t version;
+        uint32_t tileSize;
+        uint64_t width;
+        uint64_t height;
+        uint64_t generation;
+        uint16_t ruleBirth;         // Rule::birth of the rule the cells were run with
+        uint16_t ruleSurvival;
+        uint32_t reserved;
+    };
+
+    constexpr char     checkpointMagic[8] = { 'G', 'O', 'L', 'C', 'K', 'P', 'T', '\0' };
+    constexpr uint32_t checkpointVersion  = 2;
+    constexpr size_t   checkpointTileSize = 64;
+    constexpr uint64_t checkpointMaxSide  = uint64_t(1) << 31;     // Bounds the sizes read from a file, whatever it holds
+
+    // Cells of an engine packed 64 per word, every row starting on a new word, and its rule
+    struct PackedCells
+    {
+        size_t                width    = 0;
+        size_t                height   = 0;
+        size_t                rowWords = 0;
+        std::vector<uint64_t> words;
+        Rule                  rule;
+
+        void capture(IEngine const& engine)
+        {
+            rule     = engine.getRule();
+            width    = engine.getWidth();
+            height   = engine.getHeight();
+            rowWords = (width + 63) / 64;
+            words.resize(rowWords * height);
+            for (size_t y = 0; y < height; y++)
+                engine.getRowCells(0, y, words.data() + y * rowWords, width);
+        }
+    };
+
+    // Writes to a temporary file first, so that an interrupted write never replaces a valid checkpoint
+    inline bool writeCheckpoint(std::string const& fileName, PackedCells const& cells, uint64_t generation, std::string& error)
+    {
+        // A tile is exactly one word wide
+        const size_t tilesPerRow = cells.rowWords;
+        const size_t tileRows    = (cells.height + checkpointTileSize - 1) / checkpointTileSize;
+
+        std::vector<uint32_t> tileSizes(tilesPerRow * tileRows, 0);
+        std::vector<uint64_t> tileData;
+        for (size_t tileY = 0; tileY < tileRows; tileY++)
+        {
+            const size_t firstRow = tileY * checkpointTileSize;
+            const size_t nbRows   = std::min(checkpointTileSize, cells.height - firstRow);
+            for (size_t tileX = 0; tileX < tilesPerRow; tileX++)
+            {
+                uint64_t rowMask = 0;
+                for (size_t row = 0; row < nbRows; row++)
+                    if (cells.words[(firstRow + row) * cells.rowWords + tileX] != 0)
+                        rowMask |= uint64_t(1) << row;
+                if (rowMask == 0)
+                    continue;
+
+                const size_t begin = tileData.size();
+                tileData.push_back(rowMask);
+                for (size_t row = 0; row < nbRows; row++)
+                    if ((rowMask >> row) & 1)
+                        tileData.push_back(cells.words[(firstRow + row) * cells.rowWords + tileX]);
+                tileSizes[tileX + tileY * tilesPerRow] = static_cast<uint32_t>((tileData.size() - begin) * sizeof(uint64_t));
+            }
+        }
+
+        CheckpointHeader header;
+        std::memcpy(header.magic, checkpointMagic, sizeof(header.magic));
+        header.version      = checkpointVersion;
+        header.tileSize     = static_cast<uint32_t>(checkpointTileSize);
+        header.width        = cells.width;
+        header.height       = cells.height;
+        header.generation   = generation;
+        header.ruleBirth    = cells.rule.birth;
+        header.ruleSurvival = cells.rule.survival;
+        header.reserved     = 0;
+
+        const std::string temporaryName = fileName + ".tmp";
+        {
+            std::ofstream file(temporaryName, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(tileSizes.data()), tileSizes.size() * sizeof(uint32_t));
+            file.write(reinterpret_cast<const char*>(tileData.data()), tileData.size() * sizeof(uint64_t));
+            if (!file)
+            {
+                error = "cannot write " + temporaryName;
+                return false;
+            }
+        }
+
+        // The checkpoint is replaced in one step, rename() failing on Windows when it exists
+#ifdef _WIN32
+        if (!MoveFileExA(temporaryName.c_str(), fileName.c_str(), MOVEFILE_REPLACE_EXISTING))
+#else
+        if (std::rename(temporaryName.c_str(), fileName.c_str()) != 0)
+#endif
+        {
+            error = "cannot rename " + temporaryName + " to " + fileName;
+            return false;
+        }
+        return true;
+    }
+
+
+
+    // ---------------------- MAPPED FILE ----------------------//
+    // Read only view of a whole file, its pages only being read when accessed
+    class MappedFile final
+    {
+    public:
+        MappedFile(std::string const& fileName);
+        ~MappedFile();
+
+        MappedFile(MappedFile const&) = delete;
+        MappedFile& operator=(MappedFile const&) = delete;
+
+        inline bool isOpen() const           { return m_data != nullptr; }
+        inline uint8_t const* data() const   { return m_data; }
+        inline size_t size() const           { return m_size; }
+
+    private:
+        uint8_t const* m_data;
+        size_t         m_size;
+#ifdef _WIN32
+        HANDLE         m_file;
+        HANDLE         m_mapping;
+#endif
+    };
+
+#ifdef _WIN32
+    inline MappedFile::MappedFile(std::string const& fileName)
+        : m_data(nullptr), m_size(0), m_file(INVALID_HANDLE_VALUE), m_mapping(nullptr)
+    {
+        m_file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        LARGE_INTEGER size;
+        if (m_file == INVALID_HANDLE_VALUE || !GetFileSizeEx(m_file, &size) || size.QuadPart == 0)
+            return;
+
+        m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_mapping == nullptr)
+            return;
+        m_data = static_cast<uint8_t const*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+        m_size = m_data ? static_cast<size_t>(size.QuadPart) : 0;
+    }
+
+    inline MappedFile::~MappedFile()
+    {
+        if (m_data)
+            UnmapViewOfFile(m_data);
+        if (m_mapping)
+            CloseHandle(m_mapping);
+        if (m_file != INVALID_HANDLE_VALUE)
+            CloseHandle(m_file);
+    }
+#else
+    inline MappedFile::MappedFile(std::string const& fileName)
+        : m_data(nullptr), m_size(0)
+    {
+        const int file = open(fileName.c_str(), O_RDONLY);
+        if (file < 0)
+            return;
+
+        struct stat status;
+        if (fstat(file, &status) == 0 && status.st_size > 0)
+        {
+            void* data = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+            if (data != MAP_FAILED)
+            {
+                // The tiles are read in order
+                madvise(data, static_cast<size_t>(status.st_size), MADV_SEQUENTIAL);
+                m_data = static_cast<uint8_t const*>(data);
+                m_size = static_cast<size_t>(status.st_size);
+            }
+        }
+        // The mapping stays valid once the file is closed
+        close(file);
+    }
+
+    inline MappedFile::~MappedFile()
+    {
+        if (m_data)
+            munmap(const_cast<uint8_t*>(m_data), m_size);
+    }
+#endif
+
+
+
+    // ------------------- CHECKPOINT READER -------------------//
+    // Decodes a checkpoint straight from its mapped file, one row of tiles at a time
+    class CheckpointReader final
+    {
+    public:
+        CheckpointReader(std::string const& fileName);
+
+        // False if the file can't be mapped or isn't a valid checkpoint
+        inline bool isValid() const                { return m_error.empty(); }
+        inline std::string const& getError() const { return m_error; }
+        inline size_t getWidth() const             { return static_cast<size_t>(m_header.width); }
+        inline size_t getHeight() const            { return static_cast<size_t>(m_header.height); }
+        inline uint64_t getGeneration() const      { return m_header.generation; }
+        inline Rule getRule() const                { return Rule(m_header.ruleBirth, m_header.ruleSurvival); }
+
+        // Calls writeRow(y, words) for every row from top to bottom, bit b of words[i] being the cell x = 64 * i + b
+        template<typename WriteRow>
+        bool readRows(WriteRow&& writeRow);
+
+        // Overwrites every cell of the engine, which must have the size of the checkpoint.
+        // The rule of the checkpoint is set unless setsRule is false, the caller then setting its own.
+        bool loadInto(IEngine& engine, bool setsRule = true);
+
+    private:
+        MappedFile            m_file;
+        CheckpointHeader      m_header;
+        std::string           m_error;
+        size_t                m_tilesPerRow;
+        size_t                m_tileRows;
+        std::vector<uint64_t> m_tileOffsets;    // Offset of every tile in the file
+
+        inline bool fail(std::string const& error) { m_error = error; return false; }
+    };
+
+    inline CheckpointReader::CheckpointReader(std::string const& fileName)
+        : m_file(fileName), m_header(), m_tilesPerRow(0), m_tileRows(0)
+    {
+        if (!m_file.isOpen())
+        {
+            fail("cannot map " + fileName);
+            return;
+        }
+        if (m_file.size() < sizeof(CheckpointHeader))
+        {
+            fail(fileName + " is not a checkpoint");
+            return;
+        }
+
+        std::memcpy(&m_header, m_file.data(), sizeof(m_header));
+        if (std::memcmp(m_header.magic, checkpointMagic, sizeof(checkpointMagic)) != 0
+         || m_header.version != checkpointVersion || m_header.tileSize != checkpointTileSize)
+        {
+            fail(fileName + " is not a checkpoint of this version");
+            return;
+        }
+
+        if (m_header.width > checkpointMaxSide || m_header.height > checkpointMaxSide)
+        {
+            fail(fileName + " has an invalid size");
+            return;
+        }
+
+        // The tile sizes must fit in the file, which also bounds their count on 32 bit systems
+        m_tilesPerRow = static_cast<size_t>((m_header.width  + checkpointTileSize - 1) / checkpointTileSize);
+        m_tileRows    = static_cast<size_t>((m_header.height + checkpointTileSize - 1) / checkpointTileSize);
+        const size_t maxTileCount = (m_file.size() - sizeof(CheckpointHeader)) / sizeof(uint32_t);
+        if (m_tileRows != 0 && m_tilesPerRow > maxTileCount / m_tileRows)
+        {
+            fail(fileName + " is truncated");
+            return;
+        }
+        const size_t tileCount = m_tilesPerRow * m_tileRows;
+
+        // Only the offsets are kept on the heap, the tiles are decoded from the mapping
+        m_tileOffsets.resize(tileCount + 1);
+        m_tileOffsets[0] = sizeof(CheckpointHeader) + tileCount * sizeof(uint32_t);
+        for (size_t i = 0; i < tileCount; i++)
+        {
+            uint32_t size;
+            std::memcpy(&size, m_file.data() + sizeof(CheckpointHeader) + i * sizeof(uint32_t), sizeof(size));
+            m_tileOffsets[i + 1] = m_tileOffsets[i] + size;
+        }
+        if (m_tileOffsets[tileCount] > m_file.size())
+            fail(fileName + " is truncated");
+    }
+
+    template<typename WriteRow>
+    bool CheckpointReader::readRows(WriteRow&& writeRow)
+    {
+        if (!isValid())
+            return false;
+
+        // One row of tiles, a row of cells being m_tilesPerRow words
+        std::vector<uint64_t> band(checkpointTileSize * m_tilesPerRow);
+        for (size_t tileY = 0; tileY < m_tileRows; tileY++)
+        {
+            std::fill(band.begin(), band.end(), 0);
+            for (size_t tileX = 0; tileX < m_tilesPerRow; tileX++)
+            {
+                const size_t tile = tileX + tileY * m_tilesPerRow;
+                const size_t size = static_cast<size_t>(m_tileOffsets[tile + 1] - m_tileOffsets[tile]);
+                if (size == 0)
+                    continue;
+
+                // The row mask must be within the tile before it is read
+                if (size < sizeof(uint64_t))
+                    return fail("corrupted tile");
+                uint8_t const* data = m_file.data() + m_tileOffsets[tile];
+                uint64_t rowMask;
+                std::memcpy(&rowMask, data, sizeof(rowMask));
+                if (size != (1 + std::bitset<64>(rowMask).count()) * sizeof(uint64_t))
+                    return fail("corrupted tile");
+
+                data += sizeof(uint64_t);
+                for (size_t row = 0; row < checkpointTileSize; row++)
+                {
+                    if ((rowMask >> row) & 1)
+                    {
+                        std::memcpy(&band[row * m_tilesPerRow + tileX], data, sizeof(uint64_t));
+                        data += sizeof(uint64_t);
+                    }
+                }
+            }
+
+            const size_t firstRow = tileY * checkpointTileSize;
+            const size_t nbRows   = std::min<size_t>(checkpointTileSize, getHeight() - firstRow);
+            for (size_t row = 0; row < nbRows; row++)
+                writeRow(firstRow + row, band.data() + row * m_tilesPerRow);
+        }
+        return true;
+    }
+
+    inline bool CheckpointReader::loadInto(IEngine& engine, bool setsRule)
+    {
+        if (engine.getWidth() != getWidth() || engine.getHeight() != getHeight())
+            return fail("the checkpoint doesn't have the size of the grid");
+        if (setsRule && !engine.setRule(getRule()))
+            return fail("the engine can't run the rule " + getRule().toString() + " of the checkpoint");
+
+        const size_t width = getWidth();
+        return readRows([&engine, width](size_t y, uint64_t const* words)
+        {
+            engine.setRowCells(0, y, words, width);
+        });
+    }
+
+
+
+    // ------------------- CHECKPOINT WRITER -------------------//
+    // Encodes and writes checkpoints on its own thread, the caller only waiting for the cells to be copied
+    class CheckpointWriter final
+    {
+    public:
+        CheckpointWriter()
+            : m_hasPending(false), m_stopping(false)
+        {
+            m_thread = std::thread([this] { loop(); });
+        }
+
+        // The last capture is written before returning
+        ~CheckpointWriter()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stopping = true;
+            }
+            m_wakeUp.notify_one();
+            m_thread.join();
+        }
+
+        CheckpointWriter(CheckpointWriter const&) = delete;
+        CheckpointWriter& operator=(CheckpointWriter const&) = delete;
+
+        // Copies the cells of the engine, to be written to fileName. A capture still waiting to be written is replaced.
+        void capture(IEngine const& engine, uint64_t generation, std::string const& fileName)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_pending.capture(engine);
+                m_pendingGeneration = generation;
+                m_pendingFileName   = fileName;
+                m_hasPending        = true;
+            }
+            m_wakeUp.notify_one();
+        }
+
+    private:
+        std::thread             m_thread;
+        std::mutex              m_mutex;
+        std::condition_variable m_wakeUp;
+        PackedCells             m_pending;
+        uint64_t                m_pendingGeneration;
+        std::string             m_pendingFileName;
+        bool                    m_hasPending;
+        bool                    m_stopping;
+
+        void loop()
+        {
+            PackedCells cells;
+            for (;;)
+            {
+                uint64_t    generation;
+                std::string fileName;
+                {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    m_wakeUp.wait(lock, [this] { return m_hasPending || m_stopping; });
+                    if (!m_hasPending)
+                        return;
+
+                    // The buffers are swapped so that the next capture reuses the memory of the previous one
+                    std::swap(cells, m_pending);
+                    generation   = m_pendingGeneration;
+                    fileName     = m_pendingFileName;
+                    m_hasPending = false;
+                }
+
+                std::string error;
+                if (!writeCheckpoint(fileName, cells, generation, error))
+                    std::cerr << "checkpoint : " << error << std::endl;
+            }
+        }
+    };
+}
\ No newline at end of file
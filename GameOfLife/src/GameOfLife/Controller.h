@@ -2,6 +2,13 @@
 
 #include <iostream>
 #include <cassert>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
 
 #include <SFML/Graphics/RenderWindow.hpp>
 #include <SFML/Window/Event.hpp>
@@ -10,10 +17,20 @@
 #include <SFML/Graphics/Sprite.hpp>
 
 #include "Base.h"
+#include "Checkpoint.h"
 #include "Macros.h"
+#include "Profiler.h"
+#include "SimulationThread.h"
 
 #define ZOOM_MIN 0.1f
 #define ZOOM_MAX 100.f
+#define MAX_GENERATIONS_PER_FRAME 1024
+#define CHECKPOINT_FILE_NAME "checkpoint.golc"
+#define HISTORY_MAX_BYTES (256u << 20)
+#define HISTORY_KEYFRAME_INTERVAL 64
+#define DETECTION_MAX_PERIOD 64
+#define STATS_REFRESH_SECONDS 0.5f
+#define CHROME_TRACE_FILE_NAME "trace.json"
 
 template<typename T>
 std::ostream& operator<<(std::ostream& os, sf::Vector2<T> vec)
@@ -22,6 +39,12 @@ std::ostream& operator<<(std::ostream& os, sf::Vector2<T> vec)
     return os;
 }
 
+inline std::ostream& operator<<(std::ostream& os, GameOfLife::CellCoordinates cell)
+{
+    os << "(" << cell.x << ", " << cell.y << ")";
+    return os;
+}
+
 
 namespace GameOfLife
 {
@@ -46,22 +69,24 @@ namespace GameOfLife
 		const float  zoomFactorPerScrollTick;
 	};
 
-	template<size_t sideLength>
 	class Controller
 	{
 	public:
-		using EngineType = IEngine<sideLength>;
-		using ViewType = IView<sideLength>;
+		using EngineType = IEngine;
+		using ViewType = IView;
 
 		Controller(EngineType& engine, ViewType& view, sf::RenderWindow& window,
-			       float moveAmountPerSec, float zoomFactorPerScrollTick)
+			       float moveAmountPerSec, float zoomFactorPerScrollTick, uint64_t firstGeneration = 0)
 			: m_engine(engine), m_view(view), m_window(window), 
 			  m_windowInfos(static_cast<sf::Vector2f>(window.getSize()),
 				                        sf::Vector2f(1.f, 1.f)),
 			  m_camera(Camera(moveAmountPerSec, zoomFactorPerScrollTick)),
-              m_autoRun(false)
+              m_simulation(engine, view, 1, firstGeneration, &m_profiler), m_pooling(Pooling::Max),
+              m_origin(engine.getOrigin()), m_displayedOrigin(engine.getOrigin()),
+              m_profile(m_profiler.registerThread("Render")), m_showStats(false), m_activeTiles(0),
+              m_statsGeneration(firstGeneration)
         {
-            bool created = m_texture.create(static_cast<uint32_t>(sideLength), static_cast<uint32_t>(sideLength));
+            bool created = m_texture.create(static_cast<uint32_t>(engine.getWidth()), static_cast<uint32_t>(engine.getHeight()));
             assert(created);
         }
 
@@ -74,19 +99,150 @@ namespace GameOfLife
 		Camera            m_camera;
 		WindowInfos       m_windowInfos;
         sf::Texture       m_texture;
-        bool              m_autoRun;
-
-
-        void         adjustTransform(sf::Transformable& transformable, sf::FloatRect localBounds);
+        Profiler          m_profiler;           // Used from the simulation thread, must outlive it
+        CheckpointWriter  m_checkpointWriter;   // Used from the simulation thread, must outlive it
+        SimulationThread  m_simulation;
+        Pooling           m_pooling;
+        Viewport          m_displayedViewport;
+        std::vector<uint8_t> m_uploadBuffer;
+        CellCoordinates   m_origin;             // Origin of the frame once the posted commands are run
+        CellCoordinates   m_displayedOrigin;    // Origin of the frame of the displayed snapshot
+        ThreadProfile&    m_profile;
+        StageStatistics   m_statistics;
+        bool              m_showStats;
+        size_t            m_activeTiles;        // Tiles changed in the displayed snapshot
+        uint64_t          m_statsGeneration;    // Generation when the stats were last refreshed
+
+        sf::Vector2f gridOrigin() const;
+        Viewport     computeViewport() const;
+        void         adjustTransform(sf::Transformable& transformable, Viewport const& viewport);
+        void         updateTexture(Snapshot const& snapshot);
 		void         handleKeyboardState(float timeElapsed);
+        void         followCamera();
+        std::string  computeStatsText(float secondsElapsed);
         sf::Vector2f windowToWorldCoordinates(sf::Vector2f pointOnWindow);
-        sf::Vector2i worldToCellCoordinates(sf::Vector2f pointInWorld);
+        CellCoordinates worldToCellCoordinates(sf::Vector2f pointInWorld);
+
+        // The command runs after those moving the frame that were posted before it
+        inline void setCellState(CellCoordinates cellCoords, bool isAlive)
+        {
+            const size_t x = static_cast<size_t>(cellCoords.x - m_origin.x);
+            const size_t y = static_cast<size_t>(cellCoords.y - m_origin.y);
+            m_simulation.post([x, y, isAlive](IEngine& engine) { engine.setCellState(x, y, isAlive); });
+        }
+
+        // Doubles or halves the number of generations computed per displayed frame
+        inline void changeGenerationsPerFrame(bool faster)
+        {
+            const uint32_t generationsPerFrame = m_simulation.getGenerationsPerFrame();
+            if (generationsPerFrame == 0)
+                return;
+            if (faster)
+                m_simulation.setGenerationsPerFrame(std::min<uint32_t>(generationsPerFrame * 2, MAX_GENERATIONS_PER_FRAME));
+            else
+                m_simulation.setGenerationsPerFrame(std::max<uint32_t>(generationsPerFrame / 2, 1));
+        }
+
+        // The cells are copied between two generations, then written in the background.
+        // Checkpoints and history hold a grid : on an unbounded plane, they would only keep the cells of the frame.
+        // They hold one bit per cell, which would turn the dying cells of rules with more states dead.
+        inline void saveCheckpoint()
+        {
+            if (m_engine.isUnbounded())
+            {
+                std::cerr << "checkpoints aren't available on an unbounded plane" << std::endl;
+                return;
+            }
+            if (m_engine.getNbStates() > 2)
+            {
+                std::cerr << "checkpoints aren't available for rules with more than two states" << std::endl;
+                return;
+            }
+            m_simulation.post([this](IEngine& engine)
+            {
+                m_checkpointWriter.capture(engine, m_simulation.getGeneration(), CHECKPOINT_FILE_NAME);
+            });
+        }
+
+        inline void toggleHistory()
+        {
+            if (m_simulation.isRecordingHistory())
+                m_simulation.stopHistory();
+            else if (m_engine.isUnbounded())
+                std::cerr << "the history isn't available on an unbounded plane" << std::endl;
+            else if (m_engine.getNbStates() > 2)
+                std::cerr << "the history isn't available for rules with more than two states" << std::endl;
+            else
+                m_simulation.startHistory(HISTORY_MAX_BYTES, HISTORY_KEYFRAME_INTERVAL);
+        }
+
+        // The simulation pauses once the cells settle
+        inline void toggleDetection()
+        {
+            if (m_simulation.isDetecting())
+                m_simulation.stopDetection();
+            else
+                m_simulation.startDetection(DETECTION_MAX_PERIOD, true);
+        }
+
+        inline std::string getDetectionText() const
+        {
+            if (!m_simulation.isDetecting())
+                return std::string();
+            const uint32_t period = m_simulation.getDetectedPeriod();
+            if (period == 0)
+                return " | not settled";
+            return (period == 1 ? std::string(" | still") : " | period " + std::to_string(period))
+                 + " since generation " + std::to_string(m_simulation.getSettledGeneration());
+        }
+
+        // Pauses the simulation and moves through the recorded generations, as many at once as are computed per frame
+        inline void moveInHistory(bool backward)
+        {
+            if (!m_simulation.isRecordingHistory())
+                return;
+            m_simulation.setRunning(false);
+
+            const uint64_t step       = std::max<uint32_t>(m_simulation.getGenerationsPerFrame(), 1);
+            const uint64_t generation = m_simulation.getGeneration();
+            const uint64_t oldest     = m_simulation.getOldestRecorded();
+            const uint64_t newest     = m_simulation.getNewestRecorded();
+            if (backward)
+                m_simulation.restore(generation > oldest + step ? generation - step : oldest);
+            else
+                m_simulation.restore(std::min(generation + step, newest));
+        }
+
+        // Counting the population reads the whole grid, so it is only done while the stats are shown
+        inline void toggleStats()
+        {
+            m_showStats = !m_showStats;
+            m_simulation.setPopulationCounting(m_showStats);
+        }
+
+        // The events recorded while tracing are written once it stops
+        inline void toggleTracing()
+        {
+            m_profiler.setTracing(!m_profiler.isTracing());
+            if (m_profiler.isTracing())
+                return;
+            std::string error;
+            if (!m_profiler.writeChromeTrace(CHROME_TRACE_FILE_NAME, error))
+                std::cerr << "trace not saved : " << error << std::endl;
+        }
+
+        inline bool isInGrid(CellCoordinates cellCoords) const
+        {
+            const int64_t x = cellCoords.x - m_origin.x;
+            const int64_t y = cellCoords.y - m_origin.y;
+            return x >= 0 && static_cast<size_t>(x) < m_engine.getWidth()
+                && y >= 0 && static_cast<size_t>(y) < m_engine.getHeight();
+        }
 	};
 
     const char* FONT_NAME = "assets/arial.ttf";
 
-    template<size_t sideLength>
-    void Controller<sideLength>::mainLoop()
+    inline void Controller::mainLoop()
     {   
         sf::Clock clock;
 
@@ -99,10 +255,26 @@ namespace GameOfLife
         fpsText.setCharacterSize(16);
         fpsText.setFillColor(sf::Color::Yellow);
 
+        sf::Text statsText;
+        statsText.setFont(font);
+        statsText.setCharacterSize(14);
+        statsText.setFillColor(sf::Color::Yellow);
+        statsText.setPosition(0.f, 24.f);
+        sf::Clock statsClock;
+
         while (m_window.isOpen())
         {
+            ScopedTimer frameTimer(&m_profile, Stage::Frame);
             sf::Time timeElapsed = clock.restart();
-            fpsText.setString(std::to_string(static_cast<int>(1.f / timeElapsed.asSeconds())));
+            const uint32_t generationsPerFrame = m_simulation.getGenerationsPerFrame();
+            fpsText.setString(std::to_string(static_cast<int>(1.f / timeElapsed.asSeconds())) + " fps | generation "
+                            + std::to_string(m_simulation.getGeneration()) + " | "
+                            + (generationsPerFrame == 0 ? std::string("uncapped") : std::to_string(generationsPerFrame) + " gen/frame")
+                            + (m_simulation.isRecordingHistory() ? " | history " + std::to_string(m_simulation.getOldestRecorded())
+                                                                   + "-" + std::to_string(m_simulation.getNewestRecorded()) : std::string())
+                            + getDetectionText()
+                            + (m_engine.isUnbounded() ? " | center " + std::to_string(m_origin.x + static_cast<int64_t>(m_engine.getWidth() / 2))
+                                                        + ", " + std::to_string(m_origin.y + static_cast<int64_t>(m_engine.getHeight() / 2)) : std::string()));
 
             sf::Event event;
             while (m_window.pollEvent(event))
@@ -153,13 +325,12 @@ namespace GameOfLife
                             const sf::Vector2f curWinSize = static_cast<sf::Vector2f>(m_window.getSize());
                             const sf::Vector2f pointInCoordSystem = windowToWorldCoordinates(pointOnWindow);
                             GOL_LOG("point in coordinate system : " << pointInCoordSystem);
-                            const sf::Vector2i cellCoords = worldToCellCoordinates(pointInCoordSystem);
+                            const CellCoordinates cellCoords = worldToCellCoordinates(pointInCoordSystem);
                             GOL_LOG("cell coordinates : " << cellCoords);
                             
-                            if (cellCoords.x >= 0 && cellCoords.x < sideLength
-                             && cellCoords.y >= 0 && cellCoords.y < sideLength)
+                            if (isInGrid(cellCoords))
                             {
-                                m_engine.setCellState(cellCoords.x, cellCoords.y, event.mouseButton.button == sf::Mouse::Button::Left);
+                                setCellState(cellCoords, event.mouseButton.button == sf::Mouse::Button::Left);
                             }
                         }
                         break;
@@ -176,12 +347,11 @@ namespace GameOfLife
                             const sf::Vector2f curWinSize = static_cast<sf::Vector2f>(m_window.getSize());
                             const sf::Vector2f pointInCoordSystem = windowToWorldCoordinates(pointOnWindow);
                             GOL_LOG("point in coordinate system : " << pointInCoordSystem);
-                            const sf::Vector2i cellCoords = worldToCellCoordinates(pointInCoordSystem);
+                            const CellCoordinates cellCoords = worldToCellCoordinates(pointInCoordSystem);
                             GOL_LOG("cell coordinates : " << cellCoords);
                             
-                            if (cellCoords.x >= 0 && cellCoords.x < sideLength
-                             && cellCoords.y >= 0 && cellCoords.y < sideLength)
-                                m_engine.setCellState(cellCoords.x, cellCoords.y, sf::Mouse::isButtonPressed(sf::Mouse::Left));
+                            if (isInGrid(cellCoords))
+                                setCellState(cellCoords, sf::Mouse::isButtonPressed(sf::Mouse::Left));
                         }
                         break;
                     }
@@ -195,9 +365,21 @@ namespace GameOfLife
                     {
                         switch (event.key.code)
                         {
-                            case sf::Keyboard::Space:  m_autoRun = !m_autoRun;            break;
-                            case sf::Keyboard::N:      m_engine.computeNextGeneration();  break;
-                            case sf::Keyboard::C:      m_engine.clearCells();             break;
+                            case sf::Keyboard::Space:    m_simulation.setRunning(!m_simulation.isRunning());                            break;
+                            case sf::Keyboard::N:        m_simulation.step();                                                          break;
+                            case sf::Keyboard::C:        m_simulation.post([](IEngine& engine) { engine.clearCells(); });              break;
+                            case sf::Keyboard::Add:      changeGenerationsPerFrame(true);                                             break;
+                            case sf::Keyboard::Subtract: changeGenerationsPerFrame(false);                                            break;
+                            case sf::Keyboard::U:        m_simulation.setGenerationsPerFrame(generationsPerFrame == 0 ? 1 : 0);        break;
+                            case sf::Keyboard::K:        saveCheckpoint();                                                             break;
+                            case sf::Keyboard::P:        m_pooling = m_pooling == Pooling::Max ? Pooling::Density : Pooling::Max;      break;
+                            case sf::Keyboard::H:        toggleHistory();                                                              break;
+                            case sf::Keyboard::B:        moveInHistory(true);                                                          break;
+                            case sf::Keyboard::F:        moveInHistory(false);                                                         break;
+                            case sf::Keyboard::Home:     m_simulation.restore(m_simulation.getOldestRecorded());                       break;
+                            case sf::Keyboard::O:        toggleDetection();                                                            break;
+                            case sf::Keyboard::I:        toggleStats();                                                                break;
+                            case sf::Keyboard::T:        toggleTracing();                                                              break;
                         }
                         break;
                     }
@@ -206,42 +388,148 @@ namespace GameOfLife
 
             if(m_window.hasFocus())
                 handleKeyboardState(timeElapsed.asSeconds());
+            if (m_engine.isUnbounded())
+                followCamera();
 
-            if (m_autoRun)
-                m_engine.computeNextGeneration();
+            // Only the visible part of the grid is colored, at most one pixel per screen pixel
+            m_simulation.setViewport(computeViewport());
 
-            m_texture.update(m_view.computeColors().get());
+            // The simulation runs on its own thread, only its latest completed generation is drawn
+            if (Snapshot const* snapshot = m_simulation.takeLatest())
+            {
+                ScopedTimer textureTimer(&m_profile, Stage::TextureUpdate);
+                updateTexture(*snapshot);
+                m_activeTiles = snapshot->changes.countTiles();
+            }
 
-            sf::Sprite sprite(m_texture);
+            if (m_showStats && statsClock.getElapsedTime().asSeconds() >= STATS_REFRESH_SECONDS)
+                statsText.setString(computeStatsText(statsClock.restart().asSeconds()));
 
-            adjustTransform(sprite, sprite.getLocalBounds());
+            sf::Sprite sprite(m_texture, sf::IntRect(0, 0, static_cast<int>(m_displayedViewport.getPixelWidth()),
+                                                           static_cast<int>(m_displayedViewport.getPixelHeight())));
+
+            adjustTransform(sprite, m_displayedViewport);
 
             m_window.clear();
             m_window.draw(sprite);
             m_window.draw(fpsText);
+            if (m_showStats)
+                m_window.draw(statsText);
+
+            ScopedTimer displayTimer(&m_profile, Stage::Display);
             m_window.display();
         }
     }
 
-    template<size_t sideLength>
-    void Controller<sideLength>::adjustTransform(sf::Transformable& transformable, sf::FloatRect localBounds)
+    // Timings of every stage since the previous call, and the state of the simulation
+    inline std::string Controller::computeStatsText(float secondsElapsed)
     {
-        sf::Vector2f newScale = sf::Vector2f(m_camera.zoom * m_windowInfos.scale.x,
-                                             m_camera.zoom * m_windowInfos.scale.y);
-        transformable.setScale(newScale);
+        m_statistics.update(m_profiler);
 
-        sf::Vector2f scaledBounds = sf::Vector2f(newScale.x * localBounds.width,
-                                                 newScale.y * localBounds.height);
-        // put entity on the center of the screen
-        sf::Vector2f newPostion = (m_windowInfos.size - scaledBounds) * 0.5f;
+        std::ostringstream text;
+        text << std::fixed << std::setprecision(2);
+        for (size_t stage = 0; stage < nbStages; stage++)
+        {
+            StageStatistics::Percentiles const& percentiles = m_statistics.get(static_cast<Stage>(stage));
+            text << stageNames[stage] << " : p50 " << percentiles.p50 * 1e-6 << " ms | p99 " << percentiles.p99 * 1e-6
+                 << " ms | " << percentiles.count << " times\n";
+        }
+
+        const uint64_t generation = m_simulation.getGeneration();
+        const uint64_t generations = generation >= m_statsGeneration ? generation - m_statsGeneration : 0;
+        m_statsGeneration = generation;
+        text << std::setprecision(0) << generations / secondsElapsed << " gen/s | population "
+             << m_simulation.getPopulation() << " | " << m_activeTiles << " active tiles";
+        return text.str();
+    }
+
+    // Position of the top left corner of the grid in the window
+    inline sf::Vector2f Controller::gridOrigin() const
+    {
+        sf::Vector2f cellSize = sf::Vector2f(m_camera.zoom * m_windowInfos.scale.x,
+                                             m_camera.zoom * m_windowInfos.scale.y);
+        sf::Vector2f scaledBounds = sf::Vector2f(cellSize.x * m_engine.getWidth(),
+                                                 cellSize.y * m_engine.getHeight());
+        // put the grid on the center of the screen
+        sf::Vector2f origin = (m_windowInfos.size - scaledBounds) * 0.5f;
         // take camera position into account 
-        newPostion.x -= m_camera.position.x * m_windowInfos.scale.x;
-        newPostion.y -= m_camera.position.y * m_windowInfos.scale.y;
-        transformable.setPosition(newPostion);
+        origin.x -= m_camera.position.x * m_windowInfos.scale.x;
+        origin.y -= m_camera.position.y * m_windowInfos.scale.y;
+        return origin;
+    }
+
+    inline Viewport Controller::computeViewport() const
+    {
+        const sf::Vector2f origin = gridOrigin();
+        const float cellWidth  = m_camera.zoom * m_windowInfos.scale.x;
+        const float cellHeight = m_camera.zoom * m_windowInfos.scale.y;
+
+        auto clampCell = [](float cell, size_t length)
+        {
+            return static_cast<size_t>(std::min(std::max(cell, 0.f), static_cast<float>(length)));
+        };
+        const size_t beginX = clampCell(std::floor(-origin.x / cellWidth),                           m_engine.getWidth());
+        const size_t beginY = clampCell(std::floor(-origin.y / cellHeight),                          m_engine.getHeight());
+        const size_t endX   = clampCell(std::ceil((m_windowInfos.size.x - origin.x) / cellWidth),    m_engine.getWidth());
+        const size_t endY   = clampCell(std::ceil((m_windowInfos.size.y - origin.y) / cellHeight),   m_engine.getHeight());
+
+        Viewport viewport;
+        viewport.x       = beginX;
+        viewport.y       = beginY;
+        viewport.width   = endX - beginX;
+        viewport.height  = endY - beginY;
+        // When zoomed out, several cells share a pixel
+        viewport.scale   = std::max<size_t>(1, static_cast<size_t>(1.f / m_camera.zoom));
+        viewport.pooling = m_pooling;
+        return viewport;
+    }
+
+    inline void Controller::adjustTransform(sf::Transformable& transformable, Viewport const& viewport)
+    {
+        const float cellWidth  = m_camera.zoom * m_windowInfos.scale.x;
+        const float cellHeight = m_camera.zoom * m_windowInfos.scale.y;
+        transformable.setScale(sf::Vector2f(cellWidth * viewport.scale, cellHeight * viewport.scale));
+
+        // The snapshot may still show the frame before it last moved
+        const sf::Vector2f origin = gridOrigin();
+        const float frameShiftX = static_cast<float>(m_displayedOrigin.x - m_origin.x);
+        const float frameShiftY = static_cast<float>(m_displayedOrigin.y - m_origin.y);
+        transformable.setPosition(sf::Vector2f(origin.x + (viewport.x + frameShiftX) * cellWidth,
+                                               origin.y + (viewport.y + frameShiftY) * cellHeight));
+    }
+
+    // Uploads the pixels changed since the previous snapshot, or all of them when the viewport changed
+    inline void Controller::updateTexture(Snapshot const& snapshot)
+    {
+        Viewport const& viewport = snapshot.viewport;
+        const size_t pixelWidth = viewport.getPixelWidth();
+
+        if (viewport != m_displayedViewport || snapshot.origin != m_displayedOrigin)
+        {
+            m_displayedViewport = viewport;
+            m_displayedOrigin   = snapshot.origin;
+            m_texture.update(snapshot.colors.data(), static_cast<uint32_t>(pixelWidth),
+                             static_cast<uint32_t>(viewport.getPixelHeight()), 0, 0);
+            return;
+        }
+
+        snapshot.changes.forEachRect([&](Rect const& cells)
+        {
+            Rect pixels;
+            if (!viewport.getPixelRect(cells, pixels))
+                return;
+
+            // The rectangle is gathered into a contiguous buffer
+            m_uploadBuffer.resize(pixels.width * pixels.height * 4);
+            for (size_t y = 0; y < pixels.height; y++)
+                std::memcpy(m_uploadBuffer.data() + y * pixels.width * 4,
+                            snapshot.colors.data() + ((pixels.y + y) * pixelWidth + pixels.x) * 4, pixels.width * 4);
+            m_texture.update(m_uploadBuffer.data(), static_cast<uint32_t>(pixels.width), static_cast<uint32_t>(pixels.height),
+                             static_cast<uint32_t>(pixels.x), static_cast<uint32_t>(pixels.y));
+        });
     }
 
-    template<size_t sideLength>
-    void Controller<sideLength>::handleKeyboardState(float timeElapsedSeconds)
+    inline void Controller::handleKeyboardState(float timeElapsedSeconds)
     {
         float moveAmount = m_camera.moveAmountPerSec * timeElapsedSeconds;
         if (sf::Keyboard::isKeyPressed(sf::Keyboard::Z))
@@ -254,19 +542,41 @@ namespace GameOfLife
             m_camera.position.x += moveAmount;
     }
 
-    template<size_t sideLength>
-    sf::Vector2f Controller<sideLength>::windowToWorldCoordinates(sf::Vector2f pointOnWindow)
+    // On an unbounded plane the frame follows the camera : once the center of the window is more than
+    // a quarter of the frame away from the center of the frame, the frame is moved under it.
+    // The camera moves back by as much, so that its position stays small whatever the world coordinates.
+    inline void Controller::followCamera()
+    {
+        // Cells between the center of the frame and the center of the window
+        const float offsetX = m_camera.position.x / m_camera.zoom;
+        const float offsetY = m_camera.position.y / m_camera.zoom;
+        const int64_t shiftX = std::abs(offsetX) > m_engine.getWidth()  / 4.f ? static_cast<int64_t>(std::round(offsetX)) : 0;
+        const int64_t shiftY = std::abs(offsetY) > m_engine.getHeight() / 4.f ? static_cast<int64_t>(std::round(offsetY)) : 0;
+        if (shiftX == 0 && shiftY == 0)
+            return;
+
+        m_origin.x += shiftX;
+        m_origin.y += shiftY;
+        m_camera.position.x -= shiftX * m_camera.zoom;
+        m_camera.position.y -= shiftY * m_camera.zoom;
+
+        const CellCoordinates origin = m_origin;
+        m_simulation.post([origin](IEngine& engine) { engine.setOrigin(origin); });
+    }
+
+    inline sf::Vector2f Controller::windowToWorldCoordinates(sf::Vector2f pointOnWindow)
     {
         const sf::Vector2f curWinSize = sf::Vector2f(static_cast<sf::Vector2f>(m_window.getSize()));
         const sf::Vector2f distanceFromWindowCenter = curWinSize * 0.5f - pointOnWindow;
         return -(distanceFromWindowCenter - m_camera.position) / m_camera.zoom;
     }
-    template<size_t sideLength>
-    inline sf::Vector2i Controller<sideLength>::worldToCellCoordinates(sf::Vector2f pointInWorld)
+    // Cells of the frame, offset by its origin on an unbounded plane
+    inline CellCoordinates Controller::worldToCellCoordinates(sf::Vector2f pointInWorld)
     {
-        constexpr const float halfSideLength = (float)sideLength / 2.f;
+        const float halfWidth  = (float)m_engine.getWidth() / 2.f;
+        const float halfHeight = (float)m_engine.getHeight() / 2.f;
 
-        return { (int)(pointInWorld.x + halfSideLength), 
-                 (int)(pointInWorld.y + halfSideLength) };
+        return { m_origin.x + (int64_t)std::floor(pointInWorld.x + halfWidth),
+                 m_origin.y + (int64_t)std::floor(pointInWorld.y + halfHeight) };
     }
 }
\ No newline at end of file
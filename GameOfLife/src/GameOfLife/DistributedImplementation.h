@@ -0,0 +1,311 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Base.h"
+#include "BitPackedImplementation.h"
+#include "ThreadPool.h"
+#include "Transport.h"
+
+namespace GameOfLife
+{
+    // Splits a width x height torus into columns x rows rectangular domains, the process of rank r owning
+    // the domain of column r % columns and row r / columns
+    struct DomainLayout
+    {
+        size_t width;
+        size_t height;
+        size_t columns;
+        size_t rows;
+
+        inline size_t getProcessCount() const { return columns * rows; }
+
+        // Every domain must be at least as wide and high as the halos around it
+        inline bool validate(size_t haloWidth, std::string& error) const
+        {
+            if (columns == 0 || rows == 0)
+            {
+                error = "the layout needs at least one column and one row";
+                return false;
+            }
+            if (width / columns < haloWidth || height / rows < haloWidth)
+            {
+                error = "the domains of " + std::to_string(width / columns) + " x " + std::to_string(height / rows)
+                      + " cells are smaller than their halos of " + std::to_string(haloWidth) + " cells";
+                return false;
+            }
+            return true;
+        }
+
+        inline Rect getDomain(size_t rank) const
+        {
+            const size_t column = rank % columns;
+            const size_t row    = rank / columns;
+            const size_t x = column * width / columns;
+            const size_t y = row * height / rows;
+            return Rect{ x, y, (column + 1) * width / columns - x, (row + 1) * height / rows - y };
+        }
+
+        // Rank of the process owning the domain at the given offset from the one of rank, wrapping around the torus
+        inline size_t getNeighbor(size_t rank, int dx, int dy) const
+        {
+            const size_t column = (rank % columns + columns + dx) % columns;
+            const size_t row    = (rank / columns + rows + dy) % rows;
+            return row * columns + column;
+        }
+    };
+
+
+
+    // ------------------ DISTRIBUTED ENGINE -------------------//
+    // Computes the domain of one process of a torus split by a DomainLayout, the IEngine cells being those of the domain.
+    // The domain is stored bit packed, surrounded by haloWidth cells copied from the 8 neighboring domains.
+    // With a halo k cells wide, the processes exchange their borders once every k generations : the cells k cells
+    // away from the border of the domain only depend on the domain during these k generations.
+    // A step first sends the borders, then computes the whole domain while they are in flight. Once the halos
+    // are received, the bands next to the border of the domain, which read the stale halos, are computed again.
+    class DistributedEngine : public IEngine
+    {
+    public:
+        // An invalid layout, or one with another number of domains than there are processes, makes the engine fail at once
+        DistributedEngine(ITransport& transport, DomainLayout const& layout, size_t haloWidth = 1,
+                          size_t nbThreads = ThreadPool::defaultThreadCount())
+            : m_transport(transport), m_layout(layout), m_domain(domainOf(transport, layout)),
+              m_halo(std::max<size_t>(haloWidth, 1)),
+              m_paddedWidth(m_domain.width + 2 * m_halo), m_paddedHeight(m_domain.height + 2 * m_halo),
+              m_rowWords((m_paddedWidth + bitsPerWord - 1) / bitsPerWord), m_lastBit((m_paddedWidth - 1) % bitsPerWord),
+              m_cellWords(m_rowWords * m_paddedHeight, 0), m_nextCellWords(m_rowWords * m_paddedHeight, 0),
+              m_threadPool(nbThreads)
+        {
+            if (!layout.validate(m_halo, m_error))
+                return;
+            if (layout.getProcessCount() != transport.getSize())
+                m_error = "the layout has " + std::to_string(layout.getProcessCount()) + " domains for "
+                        + std::to_string(transport.getSize()) + " processes";
+        }
+
+        size_t getWidth() const override  { return m_domain.width; }
+        size_t getHeight() const override { return m_domain.height; }
+
+        // Cells of the torus owned by this process
+        inline Rect const& getDomain() const         { return m_domain; }
+        inline DomainLayout const& getLayout() const { return m_layout; }
+
+        inline bool getCellState(size_t x, size_t y) const
+        {
+            return (rowOf(y)[(x + m_halo) / bitsPerWord] >> ((x + m_halo) % bitsPerWord)) & 1;
+        }
+        void setCellState(size_t x, size_t y, bool isAlive) override
+        {
+            word_t& word = rowOf(y)[(x + m_halo) / bitsPerWord];
+            const word_t mask = word_t(1) << ((x + m_halo) % bitsPerWord);
+            word = isAlive ? word | mask : word & ~mask;
+        }
+        void clearCells() override { std::fill(m_cellWords.begin(), m_cellWords.end(), 0); }
+
+        void getRowCells(size_t x, size_t y, uint64_t* words, size_t nbCells) const override
+        {
+            copyBitsFromRow(rowOf(y), x + m_halo, words, nbCells);
+        }
+        void setRowCells(size_t x, size_t y, uint64_t const* words, size_t nbCells) override
+        {
+            copyBitsToRow(rowOf(y), x + m_halo, words, nbCells);
+        }
+
+        // Every process must compute the same generations
+        void computeNextGeneration() override { step(1); }
+        void advance(uint64_t generations) override
+        {
+            for (; generations > 0 && !hasFailed(); generations -= std::min<uint64_t>(generations, m_halo))
+                step(static_cast<size_t>(std::min<uint64_t>(generations, m_halo)));
+        }
+
+        bool setRule(Rule const& rule) override { m_rule = rule; return true; }
+        Rule getRule() const override           { return m_rule; }
+
+        // Once the transport failed, the cells are left as they are and no more generations are computed
+        inline bool hasFailed() const               { return !m_error.empty(); }
+        inline std::string const& getError() const { return m_error; }
+
+    private:
+        // Neighboring domains, the opposite of direction d being 7 - d
+        static constexpr int directions[8][2] = { { -1, -1 }, { 0, -1 }, { 1, -1 }, { -1, 0 }, { 1, 0 }, { -1, 1 }, { 0, 1 }, { 1, 1 } };
+
+        ITransport&           m_transport;
+        DomainLayout          m_layout;
+        Rect                  m_domain;
+        size_t                m_halo;
+        size_t                m_paddedWidth;
+        size_t                m_paddedHeight;
+        size_t                m_rowWords;
+        size_t                m_lastBit;
+        Rule                  m_rule;
+        std::string           m_error;
+
+        std::vector<word_t>   m_cellWords;          // The domain starts at (m_halo, m_halo)
+        std::vector<word_t>   m_nextCellWords;
+        std::vector<word_t>   m_spareCellWords;     // Intermediate generations, for halos wider than 1
+        std::vector<uint64_t> m_selfMessages[8];    // Borders sent to this process itself, when it is its own neighbor
+        std::vector<word_t>   m_bandWords;
+        std::vector<word_t>   m_nextBandWords;
+        std::vector<word_t>   m_row;
+        ThreadPool            m_threadPool;
+
+        static inline Rect domainOf(ITransport const& transport, DomainLayout const& layout)
+        {
+            const bool isValid = layout.columns != 0 && layout.rows != 0 && transport.getRank() < layout.getProcessCount();
+            return isValid ? layout.getDomain(transport.getRank()) : Rect{ 0, 0, 0, 0 };
+        }
+
+        inline word_t*       rowOf(size_t y)       { return m_cellWords.data() + (y + m_halo) * m_rowWords; }
+        inline word_t const* rowOf(size_t y) const { return m_cellWords.data() + (y + m_halo) * m_rowWords; }
+
+        // Cells of the padded grid sent to the neighbor in the direction, and those of the halo received from it
+        Rect borderRect(int dx, int dy, size_t depth) const;
+        Rect haloRect(int dx, int dy, size_t depth) const;
+
+        void step(size_t depth);
+        template<typename RuleT>
+        void computeDomain(size_t depth, RuleT const& rule);
+        template<typename RuleT>
+        void computeBand(Rect const& band, size_t depth, RuleT const& rule);
+    };
+
+    inline Rect DistributedEngine::borderRect(int dx, int dy, size_t depth) const
+    {
+        const size_t x = dx < 0 ? m_halo : dx == 0 ? m_halo : m_halo + m_domain.width - depth;
+        const size_t y = dy < 0 ? m_halo : dy == 0 ? m_halo : m_halo + m_domain.height - depth;
+        return Rect{ x, y, dx == 0 ? m_domain.width : depth, dy == 0 ? m_domain.height : depth };
+    }
+
+    inline Rect DistributedEngine::haloRect(int dx, int dy, size_t depth) const
+    {
+        const size_t x = dx < 0 ? m_halo - depth : dx == 0 ? m_halo : m_halo + m_domain.width;
+        const size_t y = dy < 0 ? m_halo - depth : dy == 0 ? m_halo : m_halo + m_domain.height;
+        return Rect{ x, y, dx == 0 ? m_domain.width : depth, dy == 0 ? m_domain.height : depth };
+    }
+
+    inline void DistributedEngine::step(size_t depth)
+    {
+        if (hasFailed())
+            return;
+
+        // The borders, packed row after row, are sent first so that they travel while the domain is computed
+        const size_t rank = m_transport.getRank();
+        for (size_t d = 0; d < 8; d++)
+        {
+            const Rect border = borderRect(directions[d][0], directions[d][1], depth);
+            const size_t messageRowWords = (border.width + bitsPerWord - 1) / bitsPerWord;
+            std::vector<uint64_t> message(messageRowWords * border.height);
+            for (size_t y = 0; y < border.height; y++)
+                copyBitsFromRow(m_cellWords.data() + (border.y + y) * m_rowWords, border.x,
+                                message.data() + y * messageRowWords, border.width);
+
+            const size_t neighbor = m_layout.getNeighbor(rank, directions[d][0], directions[d][1]);
+            if (neighbor == rank)
+                m_selfMessages[d] = std::move(message);
+            else
+                m_transport.send(neighbor, std::move(message));
+        }
+
+        dispatchRule(m_rule, [this, depth](auto const& rule) { computeDomain(depth, rule); });
+
+        // A neighbor sends its borders in the order of its directions, the opposite of ours
+        std::vector<uint64_t> message;
+        for (size_t d = 8; d-- > 0;)
+        {
+            const size_t neighbor = m_layout.getNeighbor(rank, directions[d][0], directions[d][1]);
+            if (neighbor == rank)
+                std::swap(message, m_selfMessages[7 - d]);
+            else if (!m_transport.receive(neighbor, message))
+            {
+                m_error = m_transport.getError();
+                return;
+            }
+
+            const Rect halo = haloRect(directions[d][0], directions[d][1], depth);
+            const size_t messageRowWords = (halo.width + bitsPerWord - 1) / bitsPerWord;
+            assert(message.size() == messageRowWords * halo.height);
+            for (size_t y = 0; y < halo.height; y++)
+                copyBitsToRow(m_cellWords.data() + (halo.y + y) * m_rowWords, halo.x,
+                              message.data() + y * messageRowWords, halo.width);
+        }
+
+        // The bands reach depth cells into the halos and 2 * depth cells into the domain
+        const size_t x0 = m_halo - depth;
+        const size_t y0 = m_halo - depth;
+        const size_t bandWidth  = m_domain.width  + 2 * depth;
+        const size_t bandHeight = m_domain.height + 2 * depth;
+        dispatchRule(m_rule, [&](auto const& rule)
+        {
+            computeBand(Rect{ x0, y0,                               bandWidth, 3 * depth }, depth, rule);
+            computeBand(Rect{ x0, y0 + m_domain.height - depth,     bandWidth, 3 * depth }, depth, rule);
+            computeBand(Rect{ x0,                           y0, 3 * depth, bandHeight }, depth, rule);
+            computeBand(Rect{ x0 + m_domain.width - depth,  y0, 3 * depth, bandHeight }, depth, rule);
+        });
+
+        std::swap(m_cellWords, m_nextCellWords);
+    }
+
+    // Computes depth generations of the padded grid into m_nextCellWords, leaving m_cellWords as it was.
+    // A generation only reads the previous one, so the cells next to the border of the padded grid are wrong,
+    // the wrong cells spreading one cell further every generation.
+    template<typename RuleT>
+    void DistributedEngine::computeDomain(size_t depth, RuleT const& rule)
+    {
+        if (depth > 1 && m_spareCellWords.size() != m_cellWords.size())
+            m_spareCellWords.assign(m_cellWords.size(), 0);
+
+        // The first generation goes to the next cells, the following ones back and forth with the spare cells
+        // so that the last one ends in the next cells
+        word_t const* cells = m_cellWords.data();
+        for (size_t generation = 0; generation < depth; generation++)
+        {
+            word_t* next = (depth - generation) % 2 == 1 ? m_nextCellWords.data() : m_spareCellWords.data();
+            const size_t nbTasks = std::min(m_paddedHeight - 2, m_threadPool.size() * 4);
+            m_threadPool.parallelFor(nbTasks, [this, cells, next, nbTasks, &rule](size_t task)
+            {
+                const size_t begin = 1 + task * (m_paddedHeight - 2) / nbTasks;
+                const size_t end   = 1 + (task + 1) * (m_paddedHeight - 2) / nbTasks;
+                for (size_t y = begin; y < end; y++)
+                    computeNextWordRow<0>(cells + (y - 1) * m_rowWords, cells + y * m_rowWords, cells + (y + 1) * m_rowWords,
+                                          next + y * m_rowWords, m_rowWords, m_lastBit, rule);
+            });
+            cells = next;
+        }
+    }
+
+    // Computes depth generations of the band of m_cellWords, then writes the cells at least depth cells
+    // away from the border of the band to m_nextCellWords
+    template<typename RuleT>
+    void DistributedEngine::computeBand(Rect const& band, size_t depth, RuleT const& rule)
+    {
+        const size_t bandRowWords = (band.width + bitsPerWord - 1) / bitsPerWord;
+        const size_t lastBit      = (band.width - 1) % bitsPerWord;
+        m_bandWords.assign(bandRowWords * band.height, 0);
+        m_nextBandWords.assign(bandRowWords * band.height, 0);
+        for (size_t y = 0; y < band.height; y++)
+            copyBitsFromRow(m_cellWords.data() + (band.y + y) * m_rowWords, band.x,
+                            m_bandWords.data() + y * bandRowWords, band.width);
+
+        for (size_t generation = 0; generation < depth; generation++)
+        {
+            for (size_t y = 1; y + 1 < band.height; y++)
+                computeNextWordRow<0>(m_bandWords.data() + (y - 1) * bandRowWords, m_bandWords.data() + y * bandRowWords,
+                                      m_bandWords.data() + (y + 1) * bandRowWords, m_nextBandWords.data() + y * bandRowWords,
+                                      bandRowWords, lastBit, rule);
+            std::swap(m_bandWords, m_nextBandWords);
+        }
+
+        m_row.resize(bandRowWords);
+        for (size_t y = depth; y + depth < band.height; y++)
+        {
+            copyBitsFromRow(m_bandWords.data() + y * bandRowWords, depth, m_row.data(), band.width - 2 * depth);
+            copyBitsToRow(m_nextCellWords.data() + (band.y + y) * m_rowWords, band.x + depth, m_row.data(), band.width - 2 * depth);
+        }
+    }
+}
\ No newline at end of file
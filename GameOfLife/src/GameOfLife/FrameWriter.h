@@ -0,0 +1,350 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+    #include <fcntl.h>
+    #include <io.h>
+#endif
+
+#include "Base.h"
+#include "Checkpoint.h"
+
+namespace GameOfLife
+{
+    enum class FrameFormat
+    {
+        PGM,    // 8 bit grayscale, alive cells in white
+        PNG,    // 1 bit grayscale, stored without compression
+        Raw     // A FrameHeader followed by the rows of cells, 64 per little endian uint64_t, each row starting on a new word
+    };
+
+    struct FrameHeader
+    {
+        char     magic[8];
+        uint64_t width;
+        uint64_t height;
+        uint64_t generation;
+    };
+
+    constexpr char frameMagic[8] = { 'G', 'O', 'L', 'F', 'R', 'A', 'M', 'E' };
+
+    inline const char* frameExtension(FrameFormat format)
+    {
+        switch (format)
+        {
+            case FrameFormat::PGM: return ".pgm";
+            case FrameFormat::PNG: return ".png";
+            default:               return ".raw";
+        }
+    }
+
+    inline bool isCellAlive(PackedCells const& cells, size_t x, size_t y)
+    {
+        return (cells.words[y * cells.rowWords + x / 64] >> (x % 64)) & 1;
+    }
+
+    inline void encodePGM(PackedCells const& cells, std::vector<uint8_t>& data)
+    {
+        const std::string header = "P5\n" + std::to_string(cells.width) + " " + std::to_string(cells.height) + "\n255\n";
+        data.assign(header.begin(), header.end());
+        data.resize(header.size() + cells.width * cells.height);
+
+        uint8_t* pixel = data.data() + header.size();
+        for (size_t y = 0; y < cells.height; y++)
+            for (size_t x = 0; x < cells.width; x++)
+                *pixel++ = isCellAlive(cells, x, y) ? 255 : 0;
+    }
+
+    inline void encodeRaw(PackedCells const& cells, uint64_t generation, std::vector<uint8_t>& data)
+    {
+        FrameHeader header;
+        std::memcpy(header.magic, frameMagic, sizeof(header.magic));
+        header.width      = cells.width;
+        header.height     = cells.height;
+        header.generation = generation;
+
+        data.resize(sizeof(header) + cells.words.size() * sizeof(uint64_t));
+        std::memcpy(data.data(), &header, sizeof(header));
+        std::memcpy(data.data() + sizeof(header), cells.words.data(), cells.words.size() * sizeof(uint64_t));
+    }
+
+    // ----------------------- PNG ENCODER ---------------------//
+    // The image data is deflated into stored blocks : writing it costs little more than copying it,
+    // and the files stay readable by every decoder
+    namespace Png
+    {
+        inline uint32_t crc32(uint8_t const* data, size_t size, uint32_t crc = 0)
+        {
+            static const std::vector<uint32_t> table = []
+            {
+                std::vector<uint32_t> values(256);
+                for (uint32_t n = 0; n < 256; n++)
+                {
+                    uint32_t c = n;
+                    for (int k = 0; k < 8; k++)
+                        c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                    values[n] = c;
+                }
+                return values;
+            }();
+
+            crc = ~crc;
+            for (size_t i = 0; i < size; i++)
+                crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+            return ~crc;
+        }
+
+        inline void appendBigEndian(std::vector<uint8_t>& data, uint32_t value)
+        {
+            for (int shift = 24; shift >= 0; shift -= 8)
+                data.push_back(static_cast<uint8_t>(value >> shift));
+        }
+
+        inline void appendChunk(std::vector<uint8_t>& data, const char type[4], uint8_t const* content, size_t size)
+        {
+            appendBigEndian(data, static_cast<uint32_t>(size));
+            const size_t typeIndex = data.size();
+            data.insert(data.end(), type, type + 4);
+            data.insert(data.end(), content, content + size);
+            appendBigEndian(data, crc32(data.data() + typeIndex, size + 4));
+        }
+    }
+
+    inline void encodePNG(PackedCells const& cells, std::vector<uint8_t>& data)
+    {
+        // Every row starts with its filter type, 0, followed by its pixels 8 per byte, the first one in the high bit
+        const size_t rowBytes = 1 + (cells.width + 7) / 8;
+        std::vector<uint8_t> image(rowBytes * cells.height, 0);
+        for (size_t y = 0; y < cells.height; y++)
+        {
+            uint8_t* row = image.data() + y * rowBytes + 1;
+            for (size_t x = 0; x < cells.width; x++)
+                if (isCellAlive(cells, x, y))
+                    row[x / 8] |= static_cast<uint8_t>(0x80 >> (x % 8));
+        }
+
+        // zlib stream made of stored blocks of at most 65535 bytes, followed by the Adler-32 of the image
+        constexpr size_t maxBlock = 65535;
+        std::vector<uint8_t> zlib = { 0x78, 0x01 };
+        zlib.reserve(image.size() + image.size() / maxBlock * 5 + 16);
+        size_t offset = 0;
+        do
+        {
+            const size_t blockSize = std::min(maxBlock, image.size() - offset);
+            const bool   isLast    = offset + blockSize == image.size();
+            zlib.push_back(isLast ? 1 : 0);
+            zlib.push_back(static_cast<uint8_t>(blockSize));
+            zlib.push_back(static_cast<uint8_t>(blockSize >> 8));
+            zlib.push_back(static_cast<uint8_t>(~blockSize));
+            zlib.push_back(static_cast<uint8_t>(~blockSize >> 8));
+            zlib.insert(zlib.end(), image.begin() + offset, image.begin() + offset + blockSize);
+            offset += blockSize;
+        } while (offset < image.size());
+
+        uint32_t a = 1, b = 0;
+        for (uint8_t byte : image)
+        {
+            a = (a + byte) % 65521;
+            b = (b + a) % 65521;
+        }
+        Png::appendBigEndian(zlib, (b << 16) | a);
+
+        // Width, height, bit depth 1, grayscale, then the default compression, filtering and no interlacing
+        std::vector<uint8_t> header;
+        Png::appendBigEndian(header, static_cast<uint32_t>(cells.width));
+        Png::appendBigEndian(header, static_cast<uint32_t>(cells.height));
+        header.insert(header.end(), { 1, 0, 0, 0, 0 });
+
+        static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+        data.assign(signature, signature + sizeof(signature));
+        Png::appendChunk(data, "IHDR", header.data(), header.size());
+        Png::appendChunk(data, "IDAT", zlib.data(), zlib.size());
+        Png::appendChunk(data, "IEND", nullptr, 0);
+    }
+
+
+
+    // ---------------------- FRAME WRITER ---------------------//
+    // Encodes and writes frames on its own thread, so that the simulation goes on meanwhile.
+    // At most maxQueued frames wait to be written : capturing another one waits for the writer to catch up,
+    // which bounds the memory used when the disk is slower than the simulation.
+    // The frames are either written one file each, named after the output and their generation,
+    // or all one after the other to the standard output when the output is "-".
+    class FrameWriter final
+    {
+    public:
+        FrameWriter(FrameFormat format, std::string const& output, size_t maxQueued = 4)
+            : m_format(format), m_output(output), m_maxQueued(std::max<size_t>(maxQueued, 1)),
+              m_isWriting(false), m_stopping(false), m_nbWritten(0)
+        {
+#ifdef _WIN32
+            if (isStandardOutput())
+                _setmode(_fileno(stdout), _O_BINARY);
+#endif
+            m_thread = std::thread([this] { loop(); });
+        }
+
+        // The queued frames are written before returning
+        ~FrameWriter()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stopping = true;
+            }
+            m_wakeUp.notify_all();
+            m_thread.join();
+        }
+
+        FrameWriter(FrameWriter const&) = delete;
+        FrameWriter& operator=(FrameWriter const&) = delete;
+
+        // Copies the cells of the engine, to be written in the background. Must always be called from the same thread.
+        void capture(IEngine const& engine, uint64_t generation);
+
+        // Waits until every captured frame is written, returning false with the first error if one couldn't be
+        bool finish(std::string& error);
+
+        inline size_t getWrittenCount() const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_nbWritten;
+        }
+
+    private:
+        struct Frame
+        {
+            PackedCells cells;
+            uint64_t    generation;
+        };
+
+        FrameFormat             m_format;
+        std::string             m_output;
+        size_t                  m_maxQueued;
+
+        std::thread             m_thread;
+        mutable std::mutex      m_mutex;
+        std::condition_variable m_wakeUp;       // Signals a queued frame to the writer
+        std::condition_variable m_written;      // Signals a written frame to the captures and to finish()
+        std::deque<Frame>       m_queue;
+        std::vector<Frame>      m_free;         // Written frames, whose memory is reused by the next captures
+        bool                    m_isWriting;
+        bool                    m_stopping;
+        size_t                  m_nbWritten;
+        std::string             m_error;
+
+        inline bool isStandardOutput() const { return m_output == "-"; }
+
+        bool write(Frame const& frame, std::vector<uint8_t>& data, std::string& error) const;
+        void loop();
+    };
+
+    inline void FrameWriter::capture(IEngine const& engine, uint64_t generation)
+    {
+        Frame frame;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_written.wait(lock, [this] { return m_queue.size() < m_maxQueued; });
+            if (!m_free.empty())
+            {
+                frame = std::move(m_free.back());
+                m_free.pop_back();
+            }
+        }
+
+        // Only this thread adds frames, so the queue can't fill up meanwhile
+        frame.cells.capture(engine);
+        frame.generation = generation;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_queue.push_back(std::move(frame));
+        }
+        m_wakeUp.notify_one();
+    }
+
+    inline bool FrameWriter::finish(std::string& error)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_written.wait(lock, [this] { return m_queue.empty() && !m_isWriting; });
+        error = m_error;
+        return m_error.empty();
+    }
+
+    inline bool FrameWriter::write(Frame const& frame, std::vector<uint8_t>& data, std::string& error) const
+    {
+        switch (m_format)
+        {
+            case FrameFormat::PGM: encodePGM(frame.cells, data);                   break;
+            case FrameFormat::PNG: encodePNG(frame.cells, data);                   break;
+            case FrameFormat::Raw: encodeRaw(frame.cells, frame.generation, data); break;
+        }
+
+        if (isStandardOutput())
+        {
+            if (std::fwrite(data.data(), 1, data.size(), stdout) != data.size() || std::fflush(stdout) != 0)
+            {
+                error = "cannot write to the standard output";
+                return false;
+            }
+            return true;
+        }
+
+        // The generations are padded so that the files sort in order
+        std::string number = std::to_string(frame.generation);
+        if (number.size() < 8)
+            number.insert(0, 8 - number.size(), '0');
+        const std::string fileName = m_output + number + frameExtension(m_format);
+
+        std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(data.data()), data.size());
+        if (!file)
+        {
+            error = "cannot write " + fileName;
+            return false;
+        }
+        return true;
+    }
+
+    inline void FrameWriter::loop()
+    {
+        std::vector<uint8_t> data;
+        for (;;)
+        {
+            Frame frame;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wakeUp.wait(lock, [this] { return !m_queue.empty() || m_stopping; });
+                if (m_queue.empty())
+                    return;
+                frame = std::move(m_queue.front());
+                m_queue.pop_front();
+                m_isWriting = true;
+            }
+
+            // After an error, the next frames are dropped but still taken so that the captures never wait forever
+            std::string error;
+            const bool hasFailed = !m_error.empty();
+            const bool isWritten = !hasFailed && write(frame, data, error);
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (isWritten)
+                    m_nbWritten++;
+                else if (!hasFailed)
+                    m_error = error;
+                m_free.push_back(std::move(frame));
+                m_isWriting = false;
+            }
+            m_written.notify_all();
+        }
+    }
+}
\ No newline at end of file
@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <memory>
+
 #include <cuda_runtime.h>
 #include <device_launch_parameters.h>
 
@@ -14,7 +17,7 @@ namespace GameOfLife
     using dev_cell_colors_t = uint8_t*;
 
     template<size_t sideLength>
-    class GPUEngine : public IEngine<sideLength>
+    class GPUEngine : public IEngine
     {
     public:
         GPUEngine()
@@ -32,15 +35,30 @@ namespace GameOfLife
         }
 
         inline dev_cell_states_t getDeviceCellStates() const { return m_devCellStates; }
+        size_t getWidth() const override  { return sideLength; }
+        size_t getHeight() const override { return sideLength; }
 
         // setCellState() and clearCells() will do nothing for now
         void setCellState(size_t x, size_t y, bool isAlive) override {}
         void clearCells() override {}
+        void getRowCells(size_t x, size_t y, uint64_t* words, size_t nbCells) const override
+        {
+            std::unique_ptr<bool[]> states(new bool[nbCells]);
+            CUDA_ASSERT(cudaMemcpy(states.get(), m_devCellStates + x + y * sideLength, nbCells * sizeof(bool), cudaMemcpyDeviceToHost));
+
+            std::fill(words, words + (nbCells + 63) / 64, 0);
+            for (size_t i = 0; i < nbCells; i++)
+                words[i / 64] |= uint64_t(states[i]) << (i % 64);
+        }
         void computeNextGeneration() override;
 
+        bool setRule(Rule const& rule) override { m_rule = rule; return true; }
+        Rule getRule() const override           { return m_rule; }
+
     private:
         dev_cell_states_t m_devCellStates;
         dev_cell_states_t m_devNextCellStates;
+        Rule              m_rule;
     };
 
     template<size_t sideLength> __device__
@@ -144,8 +162,9 @@ namespace GameOfLife
         return devCellStates[botRight];
     }
 
-    template<size_t sideLength> __global__
-    void computeNextGenerationOnGPU(dev_cell_states_t devCellStates, dev_cell_states_t devNextCellStates)
+    // The rule is passed by value : a StaticRule has no state, and the 18 entries of a TableRule fit in the kernel parameters
+    template<size_t sideLength, typename RuleT> __global__
+    void computeNextGenerationOnGPU(dev_cell_states_t devCellStates, dev_cell_states_t devNextCellStates, RuleT rule)
     {
         size_t curIndex = ((size_t)blockDim.x * blockIdx.x + threadIdx.x);
         if (curIndex < gridLength<sideLength>)
@@ -163,12 +182,7 @@ namespace GameOfLife
                             + midLeft             + midRight
                             + botLeft + botCenter + botRight;
 
-            switch (nbNeighbors)
-            {
-                case 2:  devNextCellStates[curIndex] = devCellStates[curIndex]; break;
-                case 3:  devNextCellStates[curIndex] = true;                    break;
-                default: devNextCellStates[curIndex] = false;                   break;
-            }
+            devNextCellStates[curIndex] = rule.nextState(devCellStates[curIndex], nbNeighbors);
         }
     }
 
@@ -179,8 +193,11 @@ namespace GameOfLife
         constexpr int blocksPerGrid = (gridLength<sideLength> + threadsPerBlock - 1) / threadsPerBlock;
 
         // Builds the next states on m_nextCellStates
-        computeNextGenerationOnGPU<sideLength> <<<blocksPerGrid, threadsPerBlock>>>
-            (m_devCellStates, m_devNextCellStates);
+        dispatchRule(m_rule, [this](auto const& rule)
+        {
+            computeNextGenerationOnGPU<sideLength> <<<blocksPerGrid, threadsPerBlock>>>
+                (m_devCellStates, m_devNextCellStates, rule);
+        });
 
         // Makes the new generation the current generation
         std::swap(m_devCellStates, m_devNextCellStates);
@@ -190,37 +207,52 @@ namespace GameOfLife
 
     // ---------------------- GPU VIEW -------------------------//
     template<size_t sideLength>
-    class GPUView : public IView<sideLength>
+    class GPUView : public IView
     {
     public:
         using EngineType = GPUEngine<sideLength>;
 
         GPUView(EngineType& engine) : 
-            m_engine(engine),
-            m_cellColors(cell_colors_t<sideLength>()) 
+            m_engine(engine)
         {
             CUDA_ASSERT(cudaMalloc((void**)&m_devCellColors, gridLength<sideLength> * 4 * sizeof(uint8_t)));
 
         }
 
-        cell_colors_t<sideLength> const& computeColors() const override;
+        void computeColors(Viewport const& viewport, uint8_t* pixels) const override;
 
     private:
         EngineType& m_engine;
-        mutable cell_colors_t<sideLength> m_cellColors;
         dev_cell_colors_t m_devCellColors;
 
         inline dev_cell_states_t getDeviceCellStates() const { return m_engine.getDeviceCellStates(); }
     };
 
+    // One thread per pixel of the viewport, each pixel pooling scale x scale cells
     __global__
-    void computeColorsOnGPU(dev_cell_colors_t devCellColors, dev_cell_states_t devCellStates, size_t gridSize)
+    void computeColorsOnGPU(dev_cell_colors_t devCellColors, dev_cell_states_t devCellStates, size_t lineSize,
+                            size_t viewX, size_t viewY, size_t viewWidth, size_t viewHeight,
+                            size_t scale, bool densityPooling)
     {
-        size_t stateIndex = (static_cast<size_t>(blockDim.x) * blockIdx.x + threadIdx.x);
-        if (stateIndex < gridSize)
+        const size_t pixelWidth  = (viewWidth  + scale - 1) / scale;
+        const size_t pixelHeight = (viewHeight + scale - 1) / scale;
+
+        size_t pixelIndex = (static_cast<size_t>(blockDim.x) * blockIdx.x + threadIdx.x);
+        if (pixelIndex < pixelWidth * pixelHeight)
         {
-            size_t colorIndex = stateIndex * 4;
-            const uint8_t color = devCellStates[stateIndex] * 200;
+            const size_t firstX = viewX + (pixelIndex % pixelWidth) * scale;
+            const size_t firstY = viewY + (pixelIndex / pixelWidth) * scale;
+            const size_t lastX  = firstX + scale < viewX + viewWidth  ? firstX + scale : viewX + viewWidth;
+            const size_t lastY  = firstY + scale < viewY + viewHeight ? firstY + scale : viewY + viewHeight;
+
+            size_t nbAlive = 0;
+            for (size_t y = firstY; y < lastY; y++)
+                for (size_t x = firstX; x < lastX; x++)
+                    nbAlive += devCellStates[x + y * lineSize];
+
+            const uint8_t color = densityPooling ? nbAlive * 200 / ((lastX - firstX) * (lastY - firstY))
+                                                 : (nbAlive > 0) * 200;
+            size_t colorIndex = pixelIndex * 4;
             devCellColors[colorIndex + 0] = 10;
             devCellColors[colorIndex + 1] = color;
             devCellColors[colorIndex + 2] = color;
@@ -229,14 +261,20 @@ namespace GameOfLife
     }
 
     template<size_t sideLength>
-    cell_colors_t<sideLength> const& GPUView<sideLength>::computeColors() const
+    void GPUView<sideLength>::computeColors(Viewport const& viewport, uint8_t* pixels) const
     {
+        const size_t nbPixels = viewport.getPixelWidth() * viewport.getPixelHeight();
+        if (nbPixels == 0)
+            return;
+
         constexpr int threadsPerBlock = 256;
-        constexpr int blocksPerGrid = (gridLength<sideLength> + threadsPerBlock - 1) / threadsPerBlock;
+        const int blocksPerGrid = static_cast<int>((nbPixels + threadsPerBlock - 1) / threadsPerBlock);
         computeColorsOnGPU<<<blocksPerGrid, threadsPerBlock>>>
-            (m_devCellColors, getDeviceCellStates(), gridLength<sideLength> * 4);
+            (m_devCellColors, getDeviceCellStates(), sideLength,
+             viewport.x, viewport.y, viewport.width, viewport.height,
+             viewport.scale, viewport.pooling == Pooling::Density);
 
-        CUDA_ASSERT(cudaMemcpy(m_cellColors.get(), m_devCellColors, gridLength<sideLength> * 4 * sizeof(uint8_t), cudaMemcpyDeviceToHost));
-        return m_cellColors;
+        // Only the pixels of the viewport are copied back
+        CUDA_ASSERT(cudaMemcpy(pixels, m_devCellColors, nbPixels * 4 * sizeof(uint8_t), cudaMemcpyDeviceToHost));
     }
 }
\ No newline at end of file
@@ -0,0 +1,499 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+#include "Base.h"
+#include "Macros.h"
+
+namespace GameOfLife
+{
+    using node_id = uint32_t;
+
+    // ---------------------- NODE STORE -----------------------//
+    // Hash-consed quadtree : a node is only stored once, whatever the number of places it appears in.
+    // A node of level k covers 2^k x 2^k cells, the two nodes of level 0 being the dead and the alive cell.
+    class NodeStore final
+    {
+    public:
+        static constexpr node_id deadCell  = 0;
+        static constexpr node_id aliveCell = 1;
+        static constexpr node_id noNode    = UINT32_MAX;
+        static constexpr uint8_t noResult  = UINT8_MAX;
+
+        struct Node
+        {
+            node_id nw, ne, sw, se;
+            node_id result;     // Center of the node advanced 2^resultStep generations
+            uint8_t level;
+            uint8_t resultStep;
+        };
+
+        NodeStore()
+        {
+            m_nodes.push_back({ noNode, noNode, noNode, noNode, noNode, 0, noResult });
+            m_nodes.push_back({ noNode, noNode, noNode, noNode, noNode, 0, noResult });
+            m_buckets.assign(1 << 16, noNode);
+        }
+
+        inline Node const& operator[](node_id id) const { return m_nodes[id]; }
+        inline size_t getNodeCount() const { return m_nodes.size(); }
+        inline size_t getMemoryUsage() const
+        {
+            return m_nodes.capacity() * sizeof(Node) + m_buckets.capacity() * sizeof(node_id);
+        }
+
+        node_id join(node_id nw, node_id ne, node_id sw, node_id se);
+        node_id emptyNode(uint8_t level);
+        inline bool isEmptyNode(node_id id) const
+        {
+            const uint8_t level = m_nodes[id].level;
+            return level < m_emptyNodes.size() && m_emptyNodes[level] == id;
+        }
+
+        // Center of the node advanced 2^step generations, step being at most level - 2.
+        // Gives up with noNode once the store uses more than its memory limit, keeping the results computed so far.
+        node_id result(node_id id, uint8_t step);
+        inline void setMemoryLimit(size_t maxMemoryBytes) { m_maxMemoryBytes = maxMemoryBytes; }
+
+        // The results computed with the previous rule are forgotten
+        void setRule(Rule const& rule);
+        inline Rule const& getRule() const { return m_rule; }
+
+        // Keeps only the nodes reachable from root, and returns the new id of root
+        node_id collect(node_id root);
+
+    private:
+        std::vector<Node>    m_nodes;
+        std::vector<node_id> m_buckets;
+        std::vector<node_id> m_emptyNodes;
+        Rule                 m_rule;
+        size_t               m_maxMemoryBytes = SIZE_MAX;
+
+        static inline size_t hash(node_id nw, node_id ne, node_id sw, node_id se)
+        {
+            uint64_t h = nw;
+            h = h * 0x9E3779B97F4A7C15ull + ne;
+            h = h * 0x9E3779B97F4A7C15ull + sw;
+            h = h * 0x9E3779B97F4A7C15ull + se;
+            return static_cast<size_t>(h ^ (h >> 29));
+        }
+
+        inline node_id centeredSubnode(node_id id)
+        {
+            const Node node = m_nodes[id];
+            return join(m_nodes[node.nw].se, m_nodes[node.ne].sw, m_nodes[node.sw].ne, m_nodes[node.se].nw);
+        }
+
+        void    growBuckets();
+        node_id baseResult(Node const& node);
+        node_id import(NodeStore const& other, node_id id, std::vector<node_id>& newIds);
+    };
+
+    inline node_id NodeStore::join(node_id nw, node_id ne, node_id sw, node_id se)
+    {
+        const size_t mask = m_buckets.size() - 1;
+        size_t bucket = hash(nw, ne, sw, se) & mask;
+        for (; m_buckets[bucket] != noNode; bucket = (bucket + 1) & mask)
+        {
+            Node const& node = m_nodes[m_buckets[bucket]];
+            if (node.nw == nw && node.ne == ne && node.sw == sw && node.se == se)
+                return m_buckets[bucket];
+        }
+
+        const node_id id = static_cast<node_id>(m_nodes.size());
+        const uint8_t level = m_nodes[nw].level + 1;
+        m_nodes.push_back({ nw, ne, sw, se, noNode, level, noResult });
+        m_buckets[bucket] = id;
+
+        // Keeps the load factor under 1/2
+        if (m_nodes.size() * 2 > m_buckets.size())
+            growBuckets();
+        return id;
+    }
+
+    inline void NodeStore::growBuckets()
+    {
+        m_buckets.assign(m_buckets.size() * 2, noNode);
+        const size_t mask = m_buckets.size() - 1;
+        for (node_id id = 2; id < m_nodes.size(); id++)
+        {
+            Node const& node = m_nodes[id];
+            size_t bucket = hash(node.nw, node.ne, node.sw, node.se) & mask;
+            while (m_buckets[bucket] != noNode)
+                bucket = (bucket + 1) & mask;
+            m_buckets[bucket] = id;
+        }
+    }
+
+    inline node_id NodeStore::emptyNode(uint8_t level)
+    {
+        if (m_emptyNodes.empty())
+            m_emptyNodes.push_back(deadCell);
+        while (m_emptyNodes.size() <= level)
+        {
+            const node_id child = m_emptyNodes.back();
+            m_emptyNodes.push_back(join(child, child, child, child));
+        }
+        return m_emptyNodes[level];
+    }
+
+    inline node_id NodeStore::baseResult(Node const& node)
+    {
+        // Node of level 2 : computes the 2x2 center cells one generation later
+        const node_id quadrants[4] = { node.nw, node.ne, node.sw, node.se };
+        bool cells[4][4];
+        for (int y = 0; y < 4; y++)
+        {
+            for (int x = 0; x < 4; x++)
+            {
+                Node const& quadrant = m_nodes[quadrants[(y / 2) * 2 + x / 2]];
+                const node_id cells2x2[4] = { quadrant.nw, quadrant.ne, quadrant.sw, quadrant.se };
+                cells[y][x] = cells2x2[(y % 2) * 2 + x % 2] == aliveCell;
+            }
+        }
+
+        node_id next[4];
+        for (int y = 1; y < 3; y++)
+        {
+            for (int x = 1; x < 3; x++)
+            {
+                const int nbNeighbors = cells[y - 1][x - 1] + cells[y - 1][x] + cells[y - 1][x + 1]
+                                      + cells[y    ][x - 1]                   + cells[y    ][x + 1]
+                                      + cells[y + 1][x - 1] + cells[y + 1][x] + cells[y + 1][x + 1];
+
+                next[(y - 1) * 2 + (x - 1)] = m_rule.nextState(cells[y][x], nbNeighbors) ? aliveCell : deadCell;
+            }
+        }
+        return join(next[0], next[1], next[2], next[3]);
+    }
+
+    inline void NodeStore::setRule(Rule const& rule)
+    {
+        m_rule = rule;
+        for (Node& node : m_nodes)
+            node.resultStep = noResult;
+    }
+
+    inline node_id NodeStore::result(node_id id, uint8_t step)
+    {
+        if (m_nodes[id].resultStep == step)
+            return m_nodes[id].result;
+        if (getMemoryUsage() > m_maxMemoryBytes)
+            return noNode;
+
+        // Copied since the nodes can be reallocated by join()
+        const Node node = m_nodes[id];
+        assert(node.level >= 2 && step <= node.level - 2);
+
+        node_id res;
+        if (node.level == 2)
+            res = baseResult(node);
+        else if (id == emptyNode(node.level))
+            res = emptyNode(node.level - 1);
+        else
+        {
+            const Node nw = m_nodes[node.nw];
+            const Node ne = m_nodes[node.ne];
+            const Node sw = m_nodes[node.sw];
+            const Node se = m_nodes[node.se];
+
+            // The 9 overlapping subnodes of level - 1
+            const node_id sub[3][3] = {
+                { node.nw,                          join(nw.ne, ne.nw, nw.se, ne.sw), node.ne                          },
+                { join(nw.sw, nw.se, sw.nw, sw.ne), join(nw.se, ne.sw, sw.ne, se.nw), join(ne.sw, ne.se, se.nw, se.ne) },
+                { node.sw,                          join(sw.ne, se.nw, sw.se, se.sw), node.se                          },
+            };
+
+            // A full step advances 2^(level - 3) generations in each stage, a smaller one only in the second stage
+            const bool    fullStep    = step == node.level - 2;
+            const uint8_t secondStep  = fullStep ? step - 1 : step;
+
+            node_id first[3][3];
+            for (int y = 0; y < 3; y++)
+                for (int x = 0; x < 3; x++)
+                    if ((first[y][x] = fullStep ? result(sub[y][x], step - 1) : centeredSubnode(sub[y][x])) == noNode)
+                        return noNode;
+
+            node_id second[2][2];
+            for (int y = 0; y < 2; y++)
+                for (int x = 0; x < 2; x++)
+                    if ((second[y][x] = result(join(first[y][x],     first[y][x + 1],
+                                                    first[y + 1][x], first[y + 1][x + 1]), secondStep)) == noNode)
+                        return noNode;
+
+            res = join(second[0][0], second[0][1], second[1][0], second[1][1]);
+        }
+
+        m_nodes[id].result     = res;
+        m_nodes[id].resultStep = step;
+        return res;
+    }
+
+    inline node_id NodeStore::import(NodeStore const& other, node_id id, std::vector<node_id>& newIds)
+    {
+        if (id <= aliveCell)
+            return id;
+        if (newIds[id] == noNode)
+        {
+            Node const& node = other.m_nodes[id];
+            const node_id nw = import(other, node.nw, newIds);
+            const node_id ne = import(other, node.ne, newIds);
+            const node_id sw = import(other, node.sw, newIds);
+            const node_id se = import(other, node.se, newIds);
+            newIds[id] = join(nw, ne, sw, se);
+        }
+        return newIds[id];
+    }
+
+    inline node_id NodeStore::collect(node_id root)
+    {
+        NodeStore collected;
+        collected.m_rule           = m_rule;
+        collected.m_maxMemoryBytes = m_maxMemoryBytes;
+        if (!m_emptyNodes.empty())
+            collected.emptyNode(static_cast<uint8_t>(m_emptyNodes.size() - 1));
+
+        std::vector<node_id> newIds(m_nodes.size(), noNode);
+        const node_id newRoot = collected.import(*this, root, newIds);
+
+        GOL_LOG("node store collected : " << m_nodes.size() << " -> " << collected.m_nodes.size() << " nodes");
+        *this = std::move(collected);
+        return newRoot;
+    }
+
+
+
+    // -------------------- HASHLIFE ENGINE --------------------//
+    // The torus of side 2^n is tiled into a node of level L >= n + 2, whose result is the tiling
+    // advanced 2^step generations. Since L - 2 >= n, the top left 2^n x 2^n corner of the result
+    // is aligned on the torus and is the new root.
+    constexpr uint8_t log2Of(size_t value) { return value <= 1 ? 0 : 1 + log2Of(value / 2); }
+
+    template<size_t sideLength>
+    class HashLifeEngine : public IEngine
+    {
+    public:
+        static_assert(sideLength >= 4 && (sideLength & (sideLength - 1)) == 0,
+                      "HashLifeEngine needs a power of two side length");
+        static constexpr uint8_t rootLevel = log2Of(sideLength);
+        static constexpr size_t  defaultMaxMemoryBytes = size_t(512) << 20;
+
+        HashLifeEngine(size_t maxMemoryBytes = defaultMaxMemoryBytes)
+            : m_maxMemoryBytes(maxMemoryBytes), m_root(m_nodes.emptyNode(rootLevel)) {}
+        HashLifeEngine(cell_states_t<sideLength> const& initial_states, size_t maxMemoryBytes = defaultMaxMemoryBytes)
+            : m_maxMemoryBytes(maxMemoryBytes), m_root(m_nodes.emptyNode(rootLevel))
+        {
+            m_root = build(initial_states, rootLevel, 0, 0);
+        }
+
+        inline NodeStore const& getNodeStore() const { return m_nodes; }
+        inline node_id getRoot() const               { return m_root; }
+        size_t getWidth() const override             { return sideLength; }
+        size_t getHeight() const override            { return sideLength; }
+        bool getCellState(size_t x, size_t y) const;
+
+        void setCellState(size_t x, size_t y, bool isAlive) override { m_root = setCell(m_root, x, y, isAlive); }
+        void clearCells() override { m_root = m_nodes.emptyNode(rootLevel); }
+        void getRowCells(size_t x, size_t y, uint64_t* words, size_t nbCells) const override;
+        void setRowCells(size_t x, size_t y, uint64_t const* words, size_t nbCells) override;
+        void computeNextGeneration() override { advance(1); }
+        void advance(uint64_t generations) override;
+
+        // The empty nodes are assumed to stay empty
+        bool setRule(Rule const& rule) override
+        {
+            if (rule.hasBirthWithoutNeighbors())
+                return false;
+            m_nodes.setRule(rule);
+            return true;
+        }
+        Rule getRule() const override { return m_nodes.getRule(); }
+
+    private:
+        NodeStore m_nodes;
+        size_t    m_maxMemoryBytes;
+        node_id   m_root;
+
+        node_id build(cell_states_t<sideLength> const& states, uint8_t level, size_t x, size_t y);
+        node_id setCell(node_id id, size_t x, size_t y, bool isAlive);
+        bool    step(uint8_t log2Generations);
+        void    advanceBy(uint8_t log2Generations);
+    };
+
+    template<size_t sideLength>
+    node_id HashLifeEngine<sideLength>::build(cell_states_t<sideLength> const& states, uint8_t level, size_t x, size_t y)
+    {
+        if (level == 0)
+            return states[x + y * sideLength] ? NodeStore::aliveCell : NodeStore::deadCell;
+
+        const size_t half = size_t(1) << (level - 1);
+        const node_id nw = build(states, level - 1, x,        y);
+        const node_id ne = build(states, level - 1, x + half, y);
+        const node_id sw = build(states, level - 1, x,        y + half);
+        const node_id se = build(states, level - 1, x + half, y + half);
+        return m_nodes.join(nw, ne, sw, se);
+    }
+
+    template<size_t sideLength>
+    bool HashLifeEngine<sideLength>::getCellState(size_t x, size_t y) const
+    {
+        node_id id = m_root;
+        for (uint8_t level = rootLevel; level > 0; level--)
+        {
+            NodeStore::Node const& node = m_nodes[id];
+            const size_t half = size_t(1) << (level - 1);
+            const bool east  = x >= half;
+            const bool south = y >= half;
+            id = south ? (east ? node.se : node.sw) : (east ? node.ne : node.nw);
+            x -= east ? half : 0;
+            y -= south ? half : 0;
+        }
+        return id == NodeStore::aliveCell;
+    }
+
+    template<size_t sideLength>
+    node_id HashLifeEngine<sideLength>::setCell(node_id id, size_t x, size_t y, bool isAlive)
+    {
+        const NodeStore::Node node = m_nodes[id];
+        if (node.level == 0)
+            return isAlive ? NodeStore::aliveCell : NodeStore::deadCell;
+
+        // Only the nodes on the path to the cell are replaced
+        const size_t half = size_t(1) << (node.level - 1);
+        const size_t subX = x % half;
+        const size_t subY = y % half;
+        if (y < half)
+        {
+            if (x < half) return m_nodes.join(setCell(node.nw, subX, subY, isAlive), node.ne, node.sw, node.se);
+            else          return m_nodes.join(node.nw, setCell(node.ne, subX, subY, isAlive), node.sw, node.se);
+        }
+        if (x < half) return m_nodes.join(node.nw, node.ne, setCell(node.sw, subX, subY, isAlive), node.se);
+        else          return m_nodes.join(node.nw, node.ne, node.sw, setCell(node.se, subX, subY, isAlive));
+    }
+
+    template<size_t sideLength>
+    void HashLifeEngine<sideLength>::getRowCells(size_t x, size_t y, uint64_t* words, size_t nbCells) const
+    {
+        std::fill(words, words + (nbCells + 63) / 64, 0);
+        for (size_t i = 0; i < nbCells; i++)
+            words[i / 64] |= uint64_t(getCellState(x + i, y)) << (i % 64);
+    }
+
+    template<size_t sideLength>
+    void HashLifeEngine<sideLength>::setRowCells(size_t x, size_t y, uint64_t const* words, size_t nbCells)
+    {
+        // Paths are only copied for the cells that actually change, loading onto an empty grid touching only the alive ones
+        for (size_t i = 0; i < nbCells; i++)
+        {
+            const bool isAlive = (words[i / 64] >> (i % 64)) & 1;
+            if (getCellState(x + i, y) != isAlive)
+                m_root = setCell(m_root, x + i, y, isAlive);
+        }
+    }
+
+    // Returns false, leaving the root as it was, when the store outgrew its memory limit during the step.
+    // A single generation always completes, so that the simulation goes on whatever the limit.
+    template<size_t sideLength>
+    bool HashLifeEngine<sideLength>::step(uint8_t log2Generations)
+    {
+        const uint8_t tiledLevel = std::max(rootLevel, log2Generations) + 2;
+
+        node_id tiled = m_root;
+        for (uint8_t level = rootLevel; level < tiledLevel; level++)
+            tiled = m_nodes.join(tiled, tiled, tiled, tiled);
+
+        m_nodes.setMemoryLimit(log2Generations == 0 ? SIZE_MAX : m_maxMemoryBytes);
+        node_id res = m_nodes.result(tiled, log2Generations);
+        if (res == NodeStore::noNode)
+            return false;
+        for (uint8_t level = tiledLevel - 1; level > rootLevel; level--)
+            res = m_nodes[res].nw;
+        m_root = res;
+        return true;
+    }
+
+    // Memory is only reclaimed between two steps, when the root is the only live node :
+    // a step outgrowing the memory limit is given up, and done again as two half steps on a collected store
+    template<size_t sideLength>
+    void HashLifeEngine<sideLength>::advanceBy(uint8_t log2Generations)
+    {
+        if (!step(log2Generations))
+        {
+            m_root = m_nodes.collect(m_root);
+            advanceBy(log2Generations - 1);
+            advanceBy(log2Generations - 1);
+        }
+        if (m_nodes.getMemoryUsage() > m_maxMemoryBytes)
+            m_root = m_nodes.collect(m_root);
+    }
+
+    template<size_t sideLength>
+    void HashLifeEngine<sideLength>::advance(uint64_t generations)
+    {
+        for (uint8_t log2Generations = 0; generations != 0; log2Generations++, generations >>= 1)
+            if ((generations & 1) != 0)
+                advanceBy(log2Generations);
+    }
+
+
+
+    // -------------------- HASHLIFE VIEW ----------------------//
+    template<size_t sideLength>
+    class HashLifeView : public IView
+    {
+    public:
+        using EngineType = HashLifeEngine<sideLength>;
+
+        HashLifeView(EngineType& engine)
+            : m_engine(engine) {}
+
+        void computeColors(Viewport const& viewport, uint8_t* pixels) const override;
+
+    private:
+        EngineType& m_engine;
+
+        size_t countAliveCells(node_id id, uint8_t level, size_t nodeX, size_t nodeY,
+                               size_t y, size_t xBegin, size_t xEnd) const;
+    };
+
+    template<size_t sideLength>
+    size_t HashLifeView<sideLength>::countAliveCells(node_id id, uint8_t level, size_t nodeX, size_t nodeY,
+                                                     size_t y, size_t xBegin, size_t xEnd) const
+    {
+        if (level == 0)
+            return id == NodeStore::aliveCell ? 1 : 0;
+
+        // Empty areas are skipped whole
+        NodeStore const& nodes = m_engine.getNodeStore();
+        if (nodes.isEmptyNode(id))
+            return 0;
+
+        // Only the half of the node holding the row y, and the quadrants overlapping [xBegin, xEnd), are visited
+        NodeStore::Node const& node = nodes[id];
+        const size_t half  = size_t(1) << (level - 1);
+        const bool   south = y >= nodeY + half;
+        const node_id west = south ? node.sw : node.nw;
+        const node_id east = south ? node.se : node.ne;
+        const size_t  subY = south ? nodeY + half : nodeY;
+
+        size_t nbAlive = 0;
+        if (xBegin < nodeX + half)
+            nbAlive += countAliveCells(west, level - 1, nodeX, subY, y, xBegin, std::min(xEnd, nodeX + half));
+        if (xEnd > nodeX + half)
+            nbAlive += countAliveCells(east, level - 1, nodeX + half, subY, y, std::max(xBegin, nodeX + half), xEnd);
+        return nbAlive;
+    }
+
+    template<size_t sideLength>
+    void HashLifeView<sideLength>::computeColors(Viewport const& viewport, uint8_t* pixels) const
+    {
+        const node_id root = m_engine.getRoot();
+        colorViewport(viewport, pixels, [this, root](size_t y, size_t xBegin, size_t xEnd)
+        {
+            return countAliveCells(root, HashLifeEngine<sideLength>::rootLevel, 0, 0, y, xBegin, xEnd);
+        });
+    }
+}
\ No newline at end of file
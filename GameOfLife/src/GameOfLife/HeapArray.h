@@ -1,6 +1,9 @@
 #pragma once
 
+#include <algorithm>
 #include <memory>
+#include <new>
+#include <type_traits>
 
 template<typename T, size_t N>
 class heap_array final
@@ -16,4 +19,34 @@ public:
 	inline void fill(T const& elem)              { std::fill(m_data.get(), m_data.get() + N, elem); }
 private:
 	std::unique_ptr<T[]> m_data;
+};
+
+// Runtime sized counterpart of heap_array, aligned for cache lines and SIMD loads.
+// Only meant for trivial types, the elements being zero initialized.
+template<typename T, size_t alignment = 64>
+class aligned_heap_array final
+{
+	static_assert(std::is_trivial<T>::value, "aligned_heap_array only holds trivial types");
+public:
+	aligned_heap_array() : m_data(nullptr), m_size(0) {}
+	explicit aligned_heap_array(size_t size) : m_data(allocate(size)), m_size(size) { fill(T()); }
+
+	inline size_t size() const                   { return m_size; }
+	inline T& operator[](size_t pos)             { return m_data[pos]; }
+	inline T const& operator[](size_t pos) const { return m_data[pos]; }
+	inline T* get() const                        { return m_data.get(); }
+	inline void fill(T const& elem)              { std::fill(m_data.get(), m_data.get() + m_size, elem); }
+private:
+	struct deleter
+	{
+		void operator()(T* data) const { ::operator delete[](data, std::align_val_t(alignment)); }
+	};
+
+	std::unique_ptr<T[], deleter> m_data;
+	size_t                        m_size;
+
+	static T* allocate(size_t size)
+	{
+		return static_cast<T*>(::operator new[](size * sizeof(T), std::align_val_t(alignment)));
+	}
 };
\ No newline at end of file
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "Base.h"
+
+namespace GameOfLife
+{
+    // Records the successive generations of an engine so that any of them can be restored.
+    // Every keyframeInterval generations the live cells are stored as a keyframe, the generations in between
+    // only store the words of 64 cells that changed, XORed with their previous value.
+    // The oldest keyframes and their deltas are dropped once the history takes more than maxBytes.
+    class HistoryRecorder final
+    {
+    public:
+        HistoryRecorder(size_t width, size_t height, size_t maxBytes, uint32_t keyframeInterval)
+            : m_width(width), m_height(height), m_rowWords((width + 63) / 64),
+              m_maxBytes(maxBytes), m_keyframeInterval(std::max<uint32_t>(keyframeInterval, 1)),
+              m_cells(m_rowWords * height, 0), m_row(m_rowWords), m_isSynced(false),
+              m_generation(0), m_sinceKeyframe(0), m_bytes(0) {}
+
+        // Records the cells of the engine as the given generation.
+        // changes holds at least the cells changed since the previous record or restore.
+        // The generations recorded after the last restored one are discarded.
+        void record(IEngine const& engine, uint64_t generation, ChangeSet const& changes);
+
+        // Sets the cells of the engine to those of a recorded generation, only rewriting the rows that differ
+        bool restore(uint64_t generation, IEngine& engine);
+
+        inline bool isEmpty() const                 { return m_frames.empty(); }
+        inline uint64_t getOldestGeneration() const { return m_frames.front().generation; }
+        inline uint64_t getNewestGeneration() const { return m_frames.back().generation; }
+        inline size_t getMemoryUsage() const        { return m_bytes; }
+
+        bool isRecorded(uint64_t generation) const;
+
+    private:
+        // The words of a keyframe are stored as is, those of a delta are XORed with the previous generation
+        struct Frame
+        {
+            uint64_t              generation;
+            bool                  isKeyframe;
+            std::vector<uint32_t> indices;
+            std::vector<uint64_t> words;
+
+            inline size_t getMemoryUsage() const
+            {
+                return sizeof(Frame) + indices.size() * sizeof(uint32_t) + words.size() * sizeof(uint64_t);
+            }
+        };
+
+        size_t                m_width;
+        size_t                m_height;
+        size_t                m_rowWords;
+        size_t                m_maxBytes;
+        uint32_t              m_keyframeInterval;
+
+        std::vector<uint64_t> m_cells;          // Cells of m_generation, 64 per word
+        std::vector<uint64_t> m_row;
+        bool                  m_isSynced;       // Whether m_cells holds the cells of the last recorded or restored generation
+        uint64_t              m_generation;
+        uint32_t              m_sinceKeyframe;
+
+        std::deque<Frame>     m_frames;         // Increasing generations, starting with a keyframe
+        size_t                m_bytes;
+        std::vector<uint32_t> m_indices;
+        std::vector<uint64_t> m_words;
+
+        void updateRows(IEngine const& engine, Rect const& cells);
+        std::deque<Frame>::const_iterator findFrame(uint64_t generation) const;
+        void push(uint64_t generation, bool isKeyframe);
+        void dropOldest();
+    };
+
+    inline void HistoryRecorder::record(IEngine const& engine, uint64_t generation, ChangeSet const& changes)
+    {
+        // Recording again after a restore starts a new branch
+        while (!m_frames.empty() && m_frames.back().generation >= generation)
+        {
+            m_bytes -= m_frames.back().getMemoryUsage();
+            m_frames.pop_back();
+        }
+
+        m_indices.clear();
+        m_words.clear();
+        if (m_isSynced)
+            changes.forEachRect([this, &engine](Rect const& cells) { updateRows(engine, cells); });
+        else
+            updateRows(engine, Rect{ 0, 0, m_width, m_height });
+
+        // A delta can only follow the previous generation
+        const bool isKeyframe = m_frames.empty() || !m_isSynced || generation != m_generation + 1
+                             || m_sinceKeyframe + 1 >= m_keyframeInterval;
+        if (isKeyframe)
+        {
+            m_indices.clear();
+            m_words.clear();
+            for (size_t i = 0; i < m_cells.size(); i++)
+                if (m_cells[i] != 0)
+                {
+                    m_indices.push_back(static_cast<uint32_t>(i));
+                    m_words.push_back(m_cells[i]);
+                }
+        }
+
+        m_isSynced = true;
+        m_generation = generation;
+        push(generation, isKeyframe);
+    }
+
+    // Reads the rows of the rectangle, the changed words being appended to the delta
+    inline void HistoryRecorder::updateRows(IEngine const& engine, Rect const& cells)
+    {
+        // The changed tiles are 64 cells wide, so they start on a word
+        const size_t firstWord = cells.x / 64;
+        const size_t nbWords   = (cells.x + cells.width + 63) / 64 - firstWord;
+        for (size_t y = cells.y; y < cells.y + cells.height; y++)
+        {
+            engine.getRowCells(firstWord * 64, y, m_row.data(), std::min(nbWords * 64, m_width - firstWord * 64));
+
+            uint64_t* current = m_cells.data() + y * m_rowWords + firstWord;
+            for (size_t i = 0; i < nbWords; i++)
+            {
+                const uint64_t changed = current[i] ^ m_row[i];
+                if (changed == 0)
+                    continue;
+                m_indices.push_back(static_cast<uint32_t>(current + i - m_cells.data()));
+                m_words.push_back(changed);
+                current[i] = m_row[i];
+            }
+        }
+    }
+
+    inline void HistoryRecorder::push(uint64_t generation, bool isKeyframe)
+    {
+        // Copied so that the frames don't keep the capacity of the scratch buffers
+        m_frames.push_back(Frame{ generation, isKeyframe,
+                                  std::vector<uint32_t>(m_indices.begin(), m_indices.end()),
+                                  std::vector<uint64_t>(m_words.begin(), m_words.end()) });
+        m_bytes += m_frames.back().getMemoryUsage();
+        m_sinceKeyframe = isKeyframe ? 0 : m_sinceKeyframe + 1;
+
+        while (m_bytes > m_maxBytes && !m_frames.empty())
+        {
+            // The frames since the newest keyframe are kept, a keyframe being forced when they are too large
+            if (std::none_of(m_frames.begin() + 1, m_frames.end(), [](Frame const& frame) { return frame.isKeyframe; }))
+            {
+                m_sinceKeyframe = m_keyframeInterval;
+                break;
+            }
+            dropOldest();
+        }
+    }
+
+    // Drops the oldest keyframe and its deltas
+    inline void HistoryRecorder::dropOldest()
+    {
+        do
+        {
+            m_bytes -= m_frames.front().getMemoryUsage();
+            m_frames.pop_front();
+        }
+        while (!m_frames.empty() && !m_frames.front().isKeyframe);
+    }
+
+    inline std::deque<HistoryRecorder::Frame>::const_iterator HistoryRecorder::findFrame(uint64_t generation) const
+    {
+        auto frame = std::lower_bound(m_frames.begin(), m_frames.end(), generation,
+                                      [](Frame const& frame, uint64_t generation) { return frame.generation < generation; });
+        return frame != m_frames.end() && frame->generation == generation ? frame : m_frames.end();
+    }
+
+    inline bool HistoryRecorder::isRecorded(uint64_t generation) const
+    {
+        return findFrame(generation) != m_frames.end();
+    }
+
+    inline bool HistoryRecorder::restore(uint64_t generation, IEngine& engine)
+    {
+        auto target = findFrame(generation);
+        if (target == m_frames.end())
+            return false;
+
+        auto keyframe = target;
+        while (!keyframe->isKeyframe)
+            --keyframe;
+
+        std::fill(m_cells.begin(), m_cells.end(), 0);
+        for (auto frame = keyframe; frame != target + 1; ++frame)
+            for (size_t i = 0; i < frame->indices.size(); i++)
+                m_cells[frame->indices[i]] ^= frame->words[i];
+
+        for (size_t y = 0; y < m_height; y++)
+        {
+            uint64_t const* row = m_cells.data() + y * m_rowWords;
+            engine.getRowCells(0, y, m_row.data(), m_width);
+            if (!std::equal(row, row + m_rowWords, m_row.data()))
+                engine.setRowCells(0, y, row, m_width);
+        }
+
+        m_isSynced = true;
+        m_generation = generation;
+        m_sinceKeyframe = static_cast<uint32_t>(target - keyframe);
+        return true;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,361 @@
+#pragma once
+
+#include <algorithm>
+#include <bitset>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+#include "Base.h"
+#include "BitPackedImplementation.h"
+#include "ChangeSet.h"
+#include "ThreadPool.h"
+
+namespace GameOfLife
+{
+    // Next states of the 2x2 cells at the center of every 4x4 neighborhood, for one rule.
+    // A 2x2 block is a nibble, bit 0 being its top left cell, bit 1 its top right, bit 2 its bottom left and bit 3 its bottom right.
+    // The 4x4 neighborhood made of the blocks a (top left), b (top right), c (bottom left) and d (bottom right)
+    // has the index a | b << 4 | c << 8 | d << 12. The 64 KiB table stays in the L2 cache.
+    class BlockTable final
+    {
+    public:
+        static constexpr size_t nbEntries = 1 << 16;
+
+        BlockTable(Rule const& rule = Rule())
+            : m_entries(nbEntries)
+        {
+            build(rule);
+        }
+
+        void build(Rule const& rule);
+        inline uint8_t operator[](size_t index) const { return m_entries[index]; }
+
+    private:
+        std::vector<uint8_t> m_entries;
+    };
+
+    inline void BlockTable::build(Rule const& rule)
+    {
+        // Cell (x, y) of the neighborhood is bit (x & 1) + 2 * (y & 1) of block (x >> 1) + 2 * (y >> 1)
+        auto isAlive = [](size_t index, int x, int y)
+        {
+            const int block = (x >> 1) + 2 * (y >> 1);
+            return (index >> (4 * block + (x & 1) + 2 * (y & 1))) & 1;
+        };
+
+        for (size_t index = 0; index < nbEntries; index++)
+        {
+            uint8_t center = 0;
+            for (int y = 1; y <= 2; y++)
+                for (int x = 1; x <= 2; x++)
+                {
+                    int nbNeighbors = 0;
+                    for (int dy = -1; dy <= 1; dy++)
+                        for (int dx = -1; dx <= 1; dx++)
+                            if (dx != 0 || dy != 0)
+                                nbNeighbors += static_cast<int>(isAlive(index, x + dx, y + dy));
+                    if (rule.nextState(isAlive(index, x, y), nbNeighbors))
+                        center |= static_cast<uint8_t>(1 << ((x - 1) + 2 * (y - 1)));
+                }
+            m_entries[index] = center;
+        }
+    }
+
+
+
+    // ----------------- LOOKUP TABLE ENGINE -------------------//
+    // Stores the torus as 2x2 blocks of cells, one per byte, each generation advancing every block with one lookup.
+    // The center of 4 blocks is a block shifted by one cell from them : the blocks of a generation are shifted by
+    // (1, 1) cell from those of the previous one, then back. The width and the height must be even.
+    // A row of cells is the top or bottom half of a row of blocks, its cells read and written 2 at a time.
+    class LookupTableEngine : public IEngine
+    {
+    public:
+        LookupTableEngine(size_t width, size_t height, size_t nbThreads = ThreadPool::defaultThreadCount())
+            : m_width(width), m_height(height), m_blocksPerRow(width / 2), m_blockRows(height / 2),
+              m_blocks(m_blocksPerRow * m_blockRows, 0), m_nextBlocks(m_blocksPerRow * m_blockRows, 0),
+              m_isShifted(false), m_threadPool(nbThreads),
+              m_changes(width, height), m_trackChanges(false),
+              m_tileWords((m_changes.getTilesPerRow() + 63) / 64), m_changedTiles(m_blockRows * m_tileWords, 0)
+        {
+            assert(width > 0 && height > 0 && width % 2 == 0 && height % 2 == 0);
+        }
+
+        size_t getWidth() const override  { return m_width; }
+        size_t getHeight() const override { return m_height; }
+
+        inline bool getCellState(size_t x, size_t y) const
+        {
+            size_t block, bit;
+            locate(x, y, block, bit);
+            return (m_blocks[block] >> bit) & 1;
+        }
+        void setCellState(size_t x, size_t y, bool isAlive) override
+        {
+            size_t block, bit;
+            locate(x, y, block, bit);
+            m_blocks[block] = static_cast<uint8_t>(isAlive ? m_blocks[block] | (1 << bit) : m_blocks[block] & ~(1 << bit));
+            m_changes.markCell(x, y);
+        }
+        void clearCells() override
+        {
+            std::fill(m_blocks.begin(), m_blocks.end(), 0);
+            m_changes.markAll();
+        }
+
+        void getRowCells(size_t x, size_t y, uint64_t* words, size_t nbCells) const override
+        {
+            for (size_t i = 0; i * bitsPerWord < nbCells; i++)
+                words[i] = readCells(x + i * bitsPerWord, y, std::min(bitsPerWord, nbCells - i * bitsPerWord));
+        }
+        void setRowCells(size_t x, size_t y, uint64_t const* words, size_t nbCells) override
+        {
+            for (size_t i = 0; i * bitsPerWord < nbCells; i++)
+                writeCells(x + i * bitsPerWord, y, std::min(bitsPerWord, nbCells - i * bitsPerWord), words[i]);
+            m_changes.markRect(Rect{ x, y, nbCells, 1 });
+        }
+
+        // Number of alive cells of the row y in [xBegin, xEnd)
+        size_t countAlive(size_t y, size_t xBegin, size_t xEnd) const
+        {
+            size_t nbAlive = 0;
+            for (size_t x = xBegin; x < xEnd; x += bitsPerWord)
+                nbAlive += std::bitset<bitsPerWord>(readCells(x, y, std::min(bitsPerWord, xEnd - x))).count();
+            return nbAlive;
+        }
+
+        void computeNextGeneration() override;
+
+        bool setRule(Rule const& rule) override
+        {
+            m_rule = rule;
+            m_table.build(rule);
+            return true;
+        }
+        Rule getRule() const override { return m_rule; }
+
+        void setChangeTracking(bool enabled) override
+        {
+            m_trackChanges = enabled;
+            m_changes.markAll();
+        }
+        bool collectChanges(ChangeSet& changes) override
+        {
+            if (!m_trackChanges)
+                return false;
+            changes.merge(m_changes);
+            m_changes.clear();
+            return true;
+        }
+
+    private:
+        size_t                m_width;
+        size_t                m_height;
+        size_t                m_blocksPerRow;
+        size_t                m_blockRows;
+        std::vector<uint8_t>  m_blocks;
+        std::vector<uint8_t>  m_nextBlocks;
+        bool                  m_isShifted;      // Whether the top left cell of the first block is (1, 1) instead of (0, 0)
+        Rule                  m_rule;
+        BlockTable            m_table;
+        ThreadPool            m_threadPool;
+
+        ChangeSet             m_changes;
+        bool                  m_trackChanges;
+        size_t                m_tileWords;
+        std::vector<uint64_t> m_changedTiles;   // Columns of the tiles changed by every row of blocks, marked after the generation
+
+        // Coordinate in the blocks of the current generation, whose first block starts on 0
+        inline size_t blockCoordinate(size_t coordinate, size_t size) const
+        {
+            return m_isShifted ? (coordinate == 0 ? size - 1 : coordinate - 1) : coordinate;
+        }
+
+        inline void locate(size_t x, size_t y, size_t& block, size_t& bit) const
+        {
+            x = blockCoordinate(x, m_width);
+            y = blockCoordinate(y, m_height);
+            block = (y / 2) * m_blocksPerRow + x / 2;
+            bit   = (x & 1) + 2 * (y & 1);
+        }
+
+        word_t readCells(size_t x, size_t y, size_t nbCells) const;
+        void   writeCells(size_t x, size_t y, size_t nbCells, word_t cells);
+        static word_t readBlockCells(uint8_t const* blocks, size_t shift, size_t x, size_t nbCells);
+        static void   writeBlockCells(uint8_t* blocks, size_t shift, size_t x, size_t nbCells, word_t cells);
+
+        template<bool trackChanges>
+        void computeBlockRow(size_t blockY);
+        void markChangedTiles();
+    };
+
+    // Reads the cells [x, x + nbCells) of a row of blocks, at most 64 and within the row, shift selecting its half
+    inline word_t LookupTableEngine::readBlockCells(uint8_t const* blocks, size_t shift, size_t x, size_t nbCells)
+    {
+        word_t cells = 0;
+        size_t bit   = 0;
+        size_t block = x / 2;
+        if (x & 1)
+        {
+            cells = (blocks[block++] >> (shift + 1)) & 1;
+            bit   = 1;
+        }
+        for (; bit < nbCells; bit += 2)
+            cells |= word_t((blocks[block++] >> shift) & 3) << bit;
+        return nbCells == bitsPerWord ? cells : cells & ((word_t(1) << nbCells) - 1);
+    }
+
+    inline void LookupTableEngine::writeBlockCells(uint8_t* blocks, size_t shift, size_t x, size_t nbCells, word_t cells)
+    {
+        for (size_t i = 0; i < nbCells;)
+        {
+            const size_t  bit     = (x + i) & 1;
+            const size_t  nbBits  = std::min<size_t>(2 - bit, nbCells - i);
+            const uint8_t mask    = static_cast<uint8_t>(((1 << nbBits) - 1) << (shift + bit));
+            const uint8_t value   = static_cast<uint8_t>(((cells >> i) << (shift + bit)) & mask);
+            uint8_t&      block   = blocks[(x + i) / 2];
+            block = static_cast<uint8_t>((block & ~mask) | value);
+            i += nbBits;
+        }
+    }
+
+    // At most 64 cells from x on. Only the first cell of a row of shifted blocks is at the end of its row of blocks.
+    inline word_t LookupTableEngine::readCells(size_t x, size_t y, size_t nbCells) const
+    {
+        const size_t  blockY = blockCoordinate(y, m_height);
+        const size_t  blockX = blockCoordinate(x, m_width);
+        uint8_t const* row   = m_blocks.data() + (blockY / 2) * m_blocksPerRow;
+        const size_t  shift  = 2 * (blockY & 1);
+        if (blockX + nbCells <= m_width)
+            return readBlockCells(row, shift, blockX, nbCells);
+        return readBlockCells(row, shift, blockX, 1) | (readBlockCells(row, shift, 0, nbCells - 1) << 1);
+    }
+
+    inline void LookupTableEngine::writeCells(size_t x, size_t y, size_t nbCells, word_t cells)
+    {
+        const size_t blockY = blockCoordinate(y, m_height);
+        const size_t blockX = blockCoordinate(x, m_width);
+        uint8_t*     row    = m_blocks.data() + (blockY / 2) * m_blocksPerRow;
+        const size_t shift  = 2 * (blockY & 1);
+        if (blockX + nbCells <= m_width)
+            writeBlockCells(row, shift, blockX, nbCells, cells);
+        else
+        {
+            writeBlockCells(row, shift, blockX, 1, cells);
+            writeBlockCells(row, shift, 0, nbCells - 1, cells >> 1);
+        }
+    }
+
+    // Unshifted blocks are the top left of the 4 blocks whose center is the next block, shifted blocks the bottom right.
+    // The cells of the next block were the inner corners of the 4 blocks, whose bits are 3, 6, 9 and 12 of the index.
+    template<bool trackChanges>
+    inline void LookupTableEngine::computeBlockRow(size_t blockY)
+    {
+        const size_t lastX = m_blocksPerRow - 1;
+        const size_t topY  = m_isShifted ? (blockY == 0 ? m_blockRows - 1 : blockY - 1) : blockY;
+        const size_t botY  = m_isShifted ? blockY : (blockY == m_blockRows - 1 ? 0 : blockY + 1);
+        uint8_t const* top = m_blocks.data() + topY * m_blocksPerRow;
+        uint8_t const* bot = m_blocks.data() + botY * m_blocksPerRow;
+        uint8_t*       out = m_nextBlocks.data() + blockY * m_blocksPerRow;
+        uint64_t*  changed = m_changedTiles.data() + blockY * m_tileWords;
+
+        // The cells of the next block x are 2 * x + offset and the one after, the next blocks being shifted the other way
+        const size_t offset = m_isShifted ? 0 : 1;
+        auto next = [this, top, bot, out, changed, offset](size_t x, size_t left, size_t right)
+        {
+            const size_t index = top[left] | (top[right] << 4) | (bot[left] << 8) | (bot[right] << 12);
+            out[x] = m_table[index];
+            if (trackChanges && out[x] != (((index >> 3) & 1) | ((index >> 5) & 2) | ((index >> 7) & 4) | ((index >> 9) & 8)))
+            {
+                const size_t firstTile = (2 * x + offset) / ChangeSet::tileSize;
+                const size_t lastTile  = (2 * x + offset + 1) % m_width / ChangeSet::tileSize;
+                changed[firstTile / 64] |= uint64_t(1) << (firstTile % 64);
+                changed[lastTile / 64]  |= uint64_t(1) << (lastTile % 64);
+            }
+        };
+
+        // Only the first or the last block of the row wraps around
+        if (m_isShifted)
+        {
+            next(0, lastX, 0);
+            for (size_t x = 1; x <= lastX; x++)
+                next(x, x - 1, x);
+        }
+        else
+        {
+            for (size_t x = 0; x < lastX; x++)
+                next(x, x, x + 1);
+            next(lastX, lastX, 0);
+        }
+    }
+
+    // The rows of blocks overlap rows of tiles, so their changes are marked once the threads are done
+    inline void LookupTableEngine::markChangedTiles()
+    {
+        const size_t offset = m_isShifted ? 1 : 0;
+        for (size_t blockY = 0; blockY < m_blockRows; blockY++)
+        {
+            uint64_t* changed = m_changedTiles.data() + blockY * m_tileWords;
+            const size_t firstTileY = (2 * blockY + offset) / ChangeSet::tileSize;
+            const size_t lastTileY  = (2 * blockY + offset + 1) % m_height / ChangeSet::tileSize;
+            for (size_t i = 0; i < m_tileWords; i++)
+            {
+                for (uint64_t tiles = changed[i]; tiles != 0; tiles &= tiles - 1)
+                {
+                    const size_t tileX = i * 64 + static_cast<size_t>(std::bitset<64>((tiles & -tiles) - 1).count());
+                    m_changes.markTile(tileX, firstTileY);
+                    m_changes.markTile(tileX, lastTileY);
+                }
+                changed[i] = 0;
+            }
+        }
+    }
+
+    inline void LookupTableEngine::computeNextGeneration()
+    {
+        // A few tasks per thread, so that those finishing early take the rows of the others
+        const size_t nbTasks = std::min(m_blockRows, m_threadPool.size() * 4);
+        m_threadPool.parallelFor(nbTasks, [this, nbTasks](size_t task)
+        {
+            const size_t begin = task * m_blockRows / nbTasks;
+            const size_t end   = (task + 1) * m_blockRows / nbTasks;
+            for (size_t blockY = begin; blockY < end; blockY++)
+            {
+                if (m_trackChanges)
+                    computeBlockRow<true>(blockY);
+                else
+                    computeBlockRow<false>(blockY);
+            }
+        });
+
+        std::swap(m_blocks, m_nextBlocks);
+        m_isShifted = !m_isShifted;
+        if (m_trackChanges)
+            markChangedTiles();
+    }
+
+
+
+    // ------------------ LOOKUP TABLE VIEW --------------------//
+    class LookupTableView : public IView
+    {
+    public:
+        using EngineType = LookupTableEngine;
+
+        LookupTableView(EngineType& engine)
+            : m_engine(engine) {}
+
+        void computeColors(Viewport const& viewport, uint8_t* pixels) const override
+        {
+            colorViewport(viewport, pixels, [this](size_t y, size_t xBegin, size_t xEnd) { return m_engine.countAlive(y, xBegin, xEnd); });
+        }
+        void updateColors(Viewport const& viewport, ChangeSet const& changes, uint8_t* pixels) const override
+        {
+            colorChangedPixels(viewport, changes, pixels, [this](size_t y, size_t xBegin, size_t xEnd) { return m_engine.countAlive(y, xBegin, xEnd); });
+        }
+
+    private:
+        EngineType& m_engine;
+    };
+}
\ No newline at end of file
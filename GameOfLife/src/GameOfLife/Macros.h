@@ -5,3 +5,11 @@
 #else
 	#define GOL_LOG(X) 
 #endif // GOL_DEBUG
+
+
+// Functions shared by the CPU engines and the CUDA kernels
+#ifdef __CUDACC__
+	#define GOL_HOST_DEVICE __host__ __device__
+#else
+	#define GOL_HOST_DEVICE
+#endif // __CUDACC__
\ No newline at end of file
@@ -0,0 +1,573 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Base.h"
+#include "Macros.h"
+#include "Periodicity.h"
+#include "ThreadPool.h"
+
+namespace GameOfLife
+{
+    // Rule of the Generations and Larger than Life families, both being generalizations of the B/S rules :
+    //  - the neighborhood is the (2 * radius + 1)^2 square around the cell, with or without the cell itself
+    //  - the cells have nbStates states : 0 is dead, 1 alive, and the others are dying.
+    //    An alive cell that doesn't survive starts dying, a dying cell goes to the next state until it is dead,
+    //    only the alive cells being counted as neighbors.
+    struct MultiStateRule
+    {
+        size_t            radius        = 1;
+        bool              includeCenter = false;
+        uint8_t           nbStates      = 2;
+        std::vector<bool> birth;            // Indexed by the number of alive neighbors
+        std::vector<bool> survival;
+
+        MultiStateRule() : MultiStateRule(Rule()) {}
+        explicit MultiStateRule(Rule const& rule, uint8_t states = 2)
+            : nbStates(states), birth(9), survival(9)
+        {
+            for (int n = 0; n <= 8; n++)
+            {
+                birth[n]    = (rule.birth >> n) & 1;
+                survival[n] = (rule.survival >> n) & 1;
+            }
+        }
+
+        inline size_t getMaxCount() const
+        {
+            const size_t side = 2 * radius + 1;
+            return side * side - (includeCenter ? 0 : 1);
+        }
+
+        // The B/S rule of a radius 1 neighborhood, B3/S23 for the others
+        Rule toRule() const;
+
+        // "B2/S/C3" or "/2/3" (survival/birth/states) for Generations,
+        // "R5,C0,M1,S34..58,B34..45,NM" for Larger than Life, and any two state rule accepted by Rule::parse()
+        static bool parse(std::string const& text, MultiStateRule& rule, std::string& error);
+        std::string toString() const;
+
+    private:
+        static bool parseCounts(std::string const& counts, std::vector<bool>& set);
+        static bool parseRange(std::string const& range, std::vector<bool>& set);
+    };
+
+    inline Rule MultiStateRule::toRule() const
+    {
+        if (radius != 1 || includeCenter)
+            return Rule();
+
+        Rule rule(0, 0);
+        for (int n = 0; n <= 8; n++)
+        {
+            rule.birth    |= birth[n]    << n;
+            rule.survival |= survival[n] << n;
+        }
+        return rule;
+    }
+
+    inline bool MultiStateRule::parseCounts(std::string const& counts, std::vector<bool>& set)
+    {
+        for (char c : counts)
+        {
+            if (c < '0' || c > '8')
+                return false;
+            set[c - '0'] = true;
+        }
+        return true;
+    }
+
+    // "min..max", or a single count
+    inline bool MultiStateRule::parseRange(std::string const& range, std::vector<bool>& set)
+    {
+        const size_t dots = range.find("..");
+        const std::string first = range.substr(0, dots);
+        const std::string last  = dots == std::string::npos ? first : range.substr(dots + 2);
+        if (first.empty() || last.empty()
+         || first.find_first_not_of("0123456789") != std::string::npos || last.find_first_not_of("0123456789") != std::string::npos)
+            return false;
+
+        const size_t min = std::strtoull(first.c_str(), nullptr, 10);
+        const size_t max = std::strtoull(last.c_str(), nullptr, 10);
+        for (size_t n = min; n <= max && n < set.size(); n++)
+            set[n] = true;
+        return min <= max;
+    }
+
+    inline bool MultiStateRule::parse(std::string const& text, MultiStateRule& rule, std::string& error)
+    {
+        std::string upper;
+        for (char c : text)
+            if (!std::isspace(static_cast<unsigned char>(c)))
+                upper += static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        error = "unsupported rule " + text;
+
+        MultiStateRule parsed;
+        if (upper.size() > 1 && upper[0] == 'R' && std::isdigit(static_cast<unsigned char>(upper[1])))
+        {
+            // Larger than Life, the sets being sized once the radius is known
+            std::vector<std::string> fields;
+            for (size_t begin = 0; begin <= upper.size();)
+            {
+                const size_t end = std::min(upper.find(',', begin), upper.size());
+                fields.push_back(upper.substr(begin, end - begin));
+                begin = end + 1;
+            }
+
+            std::string birthRange, survivalRange;
+            for (std::string const& field : fields)
+            {
+                if (field.empty())
+                    return false;
+                const std::string value = field.substr(1);
+                switch (field[0])
+                {
+                    case 'R': parsed.radius        = std::strtoull(value.c_str(), nullptr, 10);                 break;
+                    case 'C': parsed.nbStates      = static_cast<uint8_t>(std::max(2, std::min(255, std::atoi(value.c_str())))); break;
+                    case 'M': parsed.includeCenter = value == "1";                                              break;
+                    case 'S': survivalRange        = value;                                                     break;
+                    case 'B': birthRange           = value;                                                     break;
+                    case 'N':
+                        // The counts are box sums, which don't fit the von Neumann diamond
+                        if (value != "M")
+                            return false;
+                        break;
+                    default:
+                        return false;
+                }
+            }
+            if (parsed.radius == 0 || parsed.radius > 500)
+                return false;
+
+            parsed.birth.assign(parsed.getMaxCount() + 1, false);
+            parsed.survival.assign(parsed.getMaxCount() + 1, false);
+            if (!parseRange(birthRange, parsed.birth) || !parseRange(survivalRange, parsed.survival))
+                return false;
+        }
+        else
+        {
+            std::vector<std::string> fields;
+            for (size_t begin = 0; begin <= upper.size();)
+            {
+                const size_t end = std::min(upper.find('/', begin), upper.size());
+                fields.push_back(upper.substr(begin, end - begin));
+                begin = end + 1;
+            }
+
+            if (fields.size() <= 2)
+            {
+                Rule twoStates;
+                if (!Rule::parse(text, twoStates, error))
+                    return false;
+                parsed = MultiStateRule(twoStates);
+            }
+            else if (fields.size() == 3)
+            {
+                // Generations, either with letters in any order or as survival/birth/states
+                std::string counts[3];
+                const bool hasLetters = std::any_of(fields.begin(), fields.end(),
+                                                    [](std::string const& field) { return !field.empty() && std::isalpha(static_cast<unsigned char>(field[0])); });
+                for (size_t i = 0; i < 3; i++)
+                {
+                    size_t slot = i;
+                    std::string value = fields[i];
+                    if (hasLetters)
+                    {
+                        if (value.empty())
+                            return false;
+                        const char letter = value[0];
+                        slot = letter == 'S' ? 0 : letter == 'B' ? 1 : letter == 'C' || letter == 'G' ? 2 : 3;
+                        if (slot == 3)
+                            return false;
+                        value = value.substr(1);
+                    }
+                    counts[slot] = value;
+                }
+
+                const int nbStates = std::atoi(counts[2].c_str());
+                if (nbStates < 2 || nbStates > 255 || counts[2].find_first_not_of("0123456789") != std::string::npos)
+                    return false;
+                parsed.nbStates = static_cast<uint8_t>(nbStates);
+                parsed.birth.assign(9, false);
+                parsed.survival.assign(9, false);
+                if (!parseCounts(counts[0], parsed.survival) || !parseCounts(counts[1], parsed.birth))
+                    return false;
+            }
+            else
+                return false;
+        }
+
+        rule = parsed;
+        error.clear();
+        return true;
+    }
+
+    inline std::string MultiStateRule::toString() const
+    {
+        auto ranges = [](std::vector<bool> const& set)
+        {
+            std::string text;
+            for (size_t n = 0; n < set.size(); n++)
+            {
+                if (!set[n])
+                    continue;
+                size_t last = n;
+                while (last + 1 < set.size() && set[last + 1])
+                    last++;
+                text += (text.empty() ? "" : ",") + std::to_string(n) + (last > n ? ".." + std::to_string(last) : "");
+                n = last;
+            }
+            return text;
+        };
+
+        if (radius == 1 && !includeCenter)
+        {
+            const Rule rule = toRule();
+            std::string text = rule.toString();
+            return nbStates == 2 ? text : text + "/C" + std::to_string(nbStates);
+        }
+        return "R" + std::to_string(radius) + ",C" + std::to_string(nbStates) + ",M" + (includeCenter ? "1" : "0")
+             + ",S" + ranges(survival) + ",B" + ranges(birth) + ",NM";
+    }
+
+
+
+    // ------------------ MULTI STATE ENGINE -------------------//
+    // Runs a MultiStateRule on a width x height torus, one byte per cell.
+    // The alive neighbors are counted with a sliding window : the counts of the columns of 2 * radius + 1 rows
+    // are updated from one row to the next, and summed over 2 * radius + 1 columns from one cell to the next,
+    // so that a cell costs the same whatever the radius.
+    class MultiStateEngine : public IEngine
+    {
+    public:
+        static constexpr uint8_t dead  = 0;
+        static constexpr uint8_t alive = 1;
+
+        MultiStateEngine(size_t width, size_t height, MultiStateRule const& rule = MultiStateRule(),
+                         size_t nbThreads = ThreadPool::defaultThreadCount())
+            : m_width(width), m_height(height), m_states(width * height, dead), m_nextStates(width * height, dead),
+              m_threadPool(nbThreads), m_changes(width, height), m_trackChanges(false)
+        {
+            setMultiStateRule(rule);
+        }
+
+        inline uint8_t const* getStates() const              { return m_states.data(); }
+        inline uint8_t getState(size_t x, size_t y) const    { return m_states[x + y * m_width]; }
+        uint8_t getNbStates() const override                 { return m_rule.nbStates; }
+        inline MultiStateRule const& getMultiStateRule() const { return m_rule; }
+        void setMultiStateRule(MultiStateRule const& rule);
+
+        inline void setState(size_t x, size_t y, uint8_t state)
+        {
+            m_states[x + y * m_width] = state < m_rule.nbStates ? state : alive;
+            m_changes.markCell(x, y);
+        }
+
+        size_t getWidth() const override  { return m_width; }
+        size_t getHeight() const override { return m_height; }
+
+        void setCellState(size_t x, size_t y, bool isAlive) override { setState(x, y, isAlive ? alive : dead); }
+        void clearCells() override
+        {
+            std::fill(m_states.begin(), m_states.end(), dead);
+            m_changes.markAll();
+        }
+        void getRowCells(size_t x, size_t y, uint64_t* words, size_t nbCells) const override
+        {
+            uint8_t const* row = m_states.data() + x + y * m_width;
+            std::fill(words, words + (nbCells + 63) / 64, 0);
+            for (size_t i = 0; i < nbCells; i++)
+                words[i / 64] |= uint64_t(row[i] == alive) << (i % 64);
+        }
+        void setRowCells(size_t x, size_t y, uint64_t const* words, size_t nbCells) override
+        {
+            uint8_t* row = m_states.data() + x + y * m_width;
+            for (size_t i = 0; i < nbCells; i++)
+                row[i] = (words[i / 64] >> (i % 64)) & 1;
+            m_changes.markRect(Rect{ x, y, nbCells, 1 });
+        }
+        bool setRowStates(size_t x, size_t y, uint8_t const* states, size_t nbCells) override
+        {
+            uint8_t* row = m_states.data() + x + y * m_width;
+            for (size_t i = 0; i < nbCells; i++)
+                row[i] = states[i] < m_rule.nbStates ? states[i] : alive;
+            m_changes.markRect(Rect{ x, y, nbCells, 1 });
+            return true;
+        }
+        void computeNextGeneration() override;
+
+        // The dying cells block births : two generations with the same alive cells may differ
+        bool hashCells(uint64_t& hash) const override;
+
+        bool setRule(Rule const& rule) override
+        {
+            setMultiStateRule(MultiStateRule(rule, m_rule.nbStates));
+            return true;
+        }
+        Rule getRule() const override { return m_rule.toRule(); }
+
+        void setChangeTracking(bool enabled) override
+        {
+            m_trackChanges = enabled;
+            m_changes.markAll();
+        }
+        bool collectChanges(ChangeSet& changes) override
+        {
+            if (!m_trackChanges)
+                return false;
+            changes.merge(m_changes);
+            m_changes.clear();
+            return true;
+        }
+
+    private:
+        size_t               m_width;
+        size_t               m_height;
+        MultiStateRule       m_rule;
+        std::vector<uint8_t> m_states;
+        std::vector<uint8_t> m_nextStates;
+
+        // Next state of a dead and of an alive cell indexed by the number of alive neighbors, next state of the dying ones
+        std::vector<uint8_t> m_birthStates;
+        std::vector<uint8_t> m_survivalStates;
+        uint8_t              m_dyingStates[256];
+
+        ThreadPool                         m_threadPool;
+        std::vector<std::vector<uint32_t>> m_bandColumns;   // Counts of the columns, padded to wrap around, for every band
+        ChangeSet                          m_changes;
+        bool                               m_trackChanges;
+
+        void computeBand(size_t firstRow, size_t lastRow, std::vector<uint32_t>& columns);
+    };
+
+    inline void MultiStateEngine::setMultiStateRule(MultiStateRule const& rule)
+    {
+        m_rule = rule;
+        const size_t maxCount = rule.getMaxCount();
+        m_birthStates.assign(maxCount + 1, dead);
+        m_survivalStates.assign(maxCount + 1, dead);
+        for (size_t n = 0; n <= maxCount; n++)
+        {
+            m_birthStates[n]    = n < rule.birth.size() && rule.birth[n] ? alive : dead;
+            m_survivalStates[n] = n < rule.survival.size() && rule.survival[n] ? alive : (rule.nbStates > 2 ? 2 : dead);
+        }
+        for (size_t state = 0; state < 256; state++)
+            m_dyingStates[state] = state + 1 < rule.nbStates ? static_cast<uint8_t>(state + 1) : dead;
+
+        // Cells in states the rule doesn't have die
+        for (uint8_t& state : m_states)
+            if (state >= rule.nbStates)
+                state = dead;
+        m_changes.markAll();
+    }
+
+    // Hashes the states 8 at a time
+    inline bool MultiStateEngine::hashCells(uint64_t& hash) const
+    {
+        hash = 0;
+        const size_t nbCells = m_states.size();
+        for (size_t i = 0; i < nbCells; i += sizeof(uint64_t))
+        {
+            uint64_t word = 0;
+            std::memcpy(&word, m_states.data() + i, std::min(sizeof(uint64_t), nbCells - i));
+            hash += hashWord(i / sizeof(uint64_t), word);
+        }
+        return true;
+    }
+
+    inline void MultiStateEngine::computeNextGeneration()
+    {
+        // The bands are whole rows of tiles, so that they mark their own words of m_changes
+        const size_t tileRows = m_changes.getTileRows();
+        const size_t nbBands  = std::max<size_t>(1, std::min(m_threadPool.size(), tileRows));
+        m_bandColumns.resize(nbBands);
+
+        // Every band builds its rows on m_nextStates, parallelFor() returning once they are all done
+        m_threadPool.parallelFor(nbBands, [this, nbBands, tileRows](size_t band)
+        {
+            const size_t firstRow = std::min(band       * tileRows / nbBands * ChangeSet::tileSize, m_height);
+            const size_t lastRow  = std::min((band + 1) * tileRows / nbBands * ChangeSet::tileSize, m_height);
+            computeBand(firstRow, lastRow, m_bandColumns[band]);
+        });
+
+        // Makes the new generation the current generation
+        std::swap(m_states, m_nextStates);
+    }
+
+    inline void MultiStateEngine::computeBand(size_t firstRow, size_t lastRow, std::vector<uint32_t>& columns)
+    {
+        if (firstRow >= lastRow)
+            return;
+
+        const size_t radius = m_rule.radius;
+        const size_t side   = 2 * radius + 1;
+        const size_t above  = m_height - radius % m_height;     // Adding it wraps radius rows up
+
+        // columns[radius + x] counts the alive cells of the column x in the rows [y - radius, y + radius],
+        // and the radius entries on each side hold the columns they wrap around to
+        columns.assign(m_width + 2 * radius, 0);
+        uint32_t* counts = columns.data() + radius;
+        for (size_t dy = 0; dy < side; dy++)
+        {
+            uint8_t const* row = m_states.data() + (firstRow + above + dy) % m_height * m_width;
+            for (size_t x = 0; x < m_width; x++)
+                counts[x] += row[x] == alive;
+        }
+
+        for (size_t y = firstRow; y < lastRow; y++)
+        {
+            for (size_t i = 0; i < radius; i++)
+            {
+                columns[radius - 1 - i]       = counts[m_width - 1 - i % m_width];
+                columns[radius + m_width + i] = counts[i % m_width];
+            }
+
+            uint8_t const* row = m_states.data() + y * m_width;
+            uint8_t*       out = m_nextStates.data() + y * m_width;
+
+            // Sum of the columns [x - radius, x + radius]
+            uint32_t window = 0;
+            for (size_t i = 0; i < side; i++)
+                window += columns[i];
+
+            for (size_t x = 0; x < m_width; x++)
+            {
+                const uint8_t  state   = row[x];
+                const uint32_t nbAlive = window - (!m_rule.includeCenter && state == alive);
+                out[x] = state == dead  ? m_birthStates[nbAlive]
+                       : state == alive ? m_survivalStates[nbAlive]
+                                        : m_dyingStates[state];
+                if (x + 1 < m_width)
+                    window += columns[x + side] - columns[x];
+            }
+
+            if (m_trackChanges)
+                m_changes.markRow(y, row, out);
+
+            // The row y - radius leaves the window, the row y + radius + 1 enters it
+            if (y + 1 < lastRow)
+            {
+                uint8_t const* leaving  = m_states.data() + (y + above) % m_height * m_width;
+                uint8_t const* entering = m_states.data() + (y + radius + 1) % m_height * m_width;
+                for (size_t x = 0; x < m_width; x++)
+                    counts[x] += (entering[x] == alive) - (leaving[x] == alive);
+            }
+        }
+    }
+
+
+
+    // ------------------- MULTI STATE VIEW --------------------//
+    // Alive cells have the color of the other views, dying cells fade from yellow to dark red along a ramp.
+    // When zoomed out, a pixel takes the color of its most alive cell, or the mean color of its cells.
+    class MultiStateView : public IView
+    {
+    public:
+        using EngineType = MultiStateEngine;
+
+        MultiStateView(EngineType& engine)
+            : m_engine(engine) {}
+
+        void computeColors(Viewport const& viewport, uint8_t* pixels) const override
+        {
+            const std::vector<uint32_t> ramp = makeRamp(m_engine.getNbStates());
+            colorPixels(viewport, Rect{ 0, 0, viewport.getPixelWidth(), viewport.getPixelHeight() }, ramp, pixels);
+        }
+        void updateColors(Viewport const& viewport, ChangeSet const& changes, uint8_t* pixels) const override
+        {
+            const std::vector<uint32_t> ramp = makeRamp(m_engine.getNbStates());
+            changes.forEachRect([&](Rect const& cells)
+            {
+                Rect pixelRect;
+                if (viewport.getPixelRect(cells, pixelRect))
+                    colorPixels(viewport, pixelRect, ramp, pixels);
+            });
+        }
+
+    private:
+        EngineType& m_engine;
+
+        // 0x00BBGGRR color of every state
+        static std::vector<uint32_t> makeRamp(uint8_t nbStates);
+        void colorPixels(Viewport const& viewport, Rect const& pixelRect, std::vector<uint32_t> const& ramp, uint8_t* pixels) const;
+    };
+
+    inline std::vector<uint32_t> MultiStateView::makeRamp(uint8_t nbStates)
+    {
+        auto rgb = [](uint32_t r, uint32_t g, uint32_t b) { return r | (g << 8) | (b << 16); };
+
+        std::vector<uint32_t> ramp(nbStates);
+        ramp[MultiStateEngine::dead]  = rgb(10, 0, 0);
+        ramp[MultiStateEngine::alive] = rgb(10, 200, 200);
+        const size_t nbDying = nbStates > 2 ? nbStates - 2 : 0;
+        for (size_t i = 0; i < nbDying; i++)
+        {
+            // From (230, 200, 40) to (60, 10, 10)
+            const uint32_t t = nbDying > 1 ? static_cast<uint32_t>(i * 255 / (nbDying - 1)) : 0;
+            ramp[2 + i] = rgb(230 - 170 * t / 255, 200 - 190 * t / 255, 40 - 30 * t / 255);
+        }
+        return ramp;
+    }
+
+    inline void MultiStateView::colorPixels(Viewport const& viewport, Rect const& pixelRect,
+                                            std::vector<uint32_t> const& ramp, uint8_t* pixels) const
+    {
+        const size_t  endX     = viewport.x + viewport.width;
+        const size_t  endY     = viewport.y + viewport.height;
+        const size_t  width    = m_engine.getWidth();
+        const uint8_t nbStates = m_engine.getNbStates();
+        uint8_t const* states  = m_engine.getStates();
+
+        for (size_t pixelY = pixelRect.y; pixelY < pixelRect.y + pixelRect.height; pixelY++)
+        {
+            const size_t firstY = viewport.y + pixelY * viewport.scale;
+            const size_t lastY  = std::min(firstY + viewport.scale, endY);
+
+            uint8_t* pixel = pixels + (pixelY * viewport.getPixelWidth() + pixelRect.x) * 4;
+            for (size_t pixelX = pixelRect.x; pixelX < pixelRect.x + pixelRect.width; pixelX++, pixel += 4)
+            {
+                const size_t firstX = viewport.x + pixelX * viewport.scale;
+                const size_t lastX  = std::min(firstX + viewport.scale, endX);
+
+                uint32_t color;
+                if (viewport.pooling == Pooling::Max)
+                {
+                    // Alive first, then the dying states from the youngest
+                    uint8_t best = MultiStateEngine::dead;
+                    for (size_t y = firstY; y < lastY && best != MultiStateEngine::alive; y++)
+                        for (size_t x = firstX; x < lastX; x++)
+                        {
+                            const uint8_t state = std::min<uint8_t>(states[x + y * width], nbStates - 1);
+                            if (state != MultiStateEngine::dead && (best == MultiStateEngine::dead || state < best))
+                                best = state;
+                        }
+                    color = ramp[best];
+                }
+                else
+                {
+                    uint32_t sums[3] = { 0, 0, 0 };
+                    for (size_t y = firstY; y < lastY; y++)
+                        for (size_t x = firstX; x < lastX; x++)
+                        {
+                            const uint32_t cellColor = ramp[std::min<uint8_t>(states[x + y * width], nbStates - 1)];
+                            for (int channel = 0; channel < 3; channel++)
+                                sums[channel] += (cellColor >> (8 * channel)) & 0xFF;
+                        }
+                    const uint32_t nbCells = static_cast<uint32_t>((lastY - firstY) * (lastX - firstX));
+                    color = (sums[0] / nbCells) | ((sums[1] / nbCells) << 8) | ((sums[2] / nbCells) << 16);
+                }
+
+                pixel[0] = color & 0xFF;
+                pixel[1] = (color >> 8) & 0xFF;
+                pixel[2] = (color >> 16) & 0xFF;
+                pixel[3] = 255;
+            }
+        }
+    }
+}
\ No newline at end of file
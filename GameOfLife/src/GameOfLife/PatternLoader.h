@@ -0,0 +1,612 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "Base.h"
+
+namespace GameOfLife
+{
+    enum class PatternFormat : uint8_t
+    {
+        RLE,            // Run length encoded, as written by Golly and the LifeWiki
+        Plaintext,      // .cells : one character per cell, 'O' for the alive ones
+        Macrocell       // .mc : quadtree of 8x8 leaves, as written by Golly
+    };
+
+    struct PatternInfo
+    {
+        size_t      width  = 0;
+        size_t      height = 0;
+        std::string rule;           // As written in the file, empty if there is none
+    };
+
+    // Sets the bits [begin, begin + length) of words
+    inline void setBitRun(uint64_t* words, size_t begin, size_t length)
+    {
+        while (length > 0)
+        {
+            const size_t bit    = begin % 64;
+            const size_t nbBits = std::min<size_t>(64 - bit, length);
+            words[begin / 64] |= (nbBits == 64 ? ~uint64_t(0) : (uint64_t(1) << nbBits) - 1) << bit;
+            begin  += nbBits;
+            length -= nbBits;
+        }
+    }
+
+    inline bool isDigit(int c) { return c >= '0' && c <= '9'; }
+    inline bool isSpace(int c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
+
+    // Reads the input by large blocks, handing it over one character at a time
+    class CharReader final
+    {
+    public:
+        static constexpr size_t bufferSize = 1 << 16;
+
+        CharReader(std::istream& input)
+            : m_input(input), m_buffer(bufferSize), m_position(0), m_size(0) {}
+
+        inline int peek()
+        {
+            if (m_position == m_size && !refill())
+                return EOF;
+            return static_cast<unsigned char>(m_buffer[m_position]);
+        }
+        inline int get()
+        {
+            const int c = peek();
+            if (c != EOF)
+                m_position++;
+            return c;
+        }
+
+        // Reads up to the end of the line, which is consumed but not returned. False at the end of the input.
+        bool readLine(std::string& line);
+        // Reads a decimal number, defaultValue if there is none
+        size_t readNumber(size_t defaultValue);
+        // Goes back to the beginning of the input, which must be seekable
+        void rewind();
+
+    private:
+        std::istream&     m_input;
+        std::vector<char> m_buffer;
+        size_t            m_position;
+        size_t            m_size;
+
+        inline bool refill()
+        {
+            m_input.read(m_buffer.data(), bufferSize);
+            m_size     = static_cast<size_t>(m_input.gcount());
+            m_position = 0;
+            return m_size > 0;
+        }
+    };
+
+    inline bool CharReader::readLine(std::string& line)
+    {
+        line.clear();
+        int c = get();
+        if (c == EOF)
+            return false;
+        for (; c != EOF && c != '\n'; c = get())
+            if (c != '\r')
+                line.push_back(static_cast<char>(c));
+        return true;
+    }
+
+    inline size_t CharReader::readNumber(size_t defaultValue)
+    {
+        if (!isDigit(peek()))
+            return defaultValue;
+        size_t number = 0;
+        while (isDigit(peek()))
+            number = number * 10 + (get() - '0');
+        return number;
+    }
+
+    inline void CharReader::rewind()
+    {
+        m_input.clear();
+        m_input.seekg(0);
+        m_position = 0;
+        m_size     = 0;
+    }
+
+
+
+    // ------------------- PATTERN LOADER ----------------------//
+    // Streams a pattern file, handing it over one row of bits at a time so that
+    // it can be written to the storage of an engine by whole words.
+    class PatternLoader final
+    {
+    public:
+        PatternLoader(std::istream& input, PatternFormat format)
+            : m_reader(input), m_format(format), m_rowHasStates(false) {}
+
+        // Reads the size and the rule of the pattern, false if they are malformed.
+        // Plaintext patterns are read twice to be measured and Macrocell ones are read entirely.
+        bool readHeader();
+        inline PatternInfo const& getInfo() const  { return m_info; }
+        inline std::string const& getError() const { return m_error; }
+
+        // Calls writeRow(y, words) for every row of the pattern from top to bottom, including the empty ones.
+        // Bit b of words[i] is the state of the cell x = 64 * i + b of the row. The cells of multistate RLE patterns
+        // past the alive state are left out of words, loadInto() writing them to the engines that have such states.
+        template<typename WriteRow>
+        bool readRows(WriteRow&& writeRow);
+
+        // Overwrites the cells covered by the pattern, its top left corner being put on (x, y)
+        bool loadInto(IEngine& engine, size_t x, size_t y);
+
+        // The format given by the extension of the file name, RLE if it is unknown
+        static PatternFormat formatOf(std::string const& fileName);
+
+    private:
+        // Leaves hold 8x8 cells, bit x + 8 * y of leafRows being the cell (x, y)
+        struct MacrocellNode
+        {
+            uint32_t level;
+            uint32_t children[4];       // nw, ne, sw, se, 0 being the empty node
+            uint64_t leafRows;
+            uint64_t minX, minY, maxX, maxY;
+        };
+
+        CharReader                 m_reader;
+        PatternFormat              m_format;
+        PatternInfo                m_info;
+        std::string                m_error;
+        std::vector<MacrocellNode> m_nodes;
+        std::vector<uint64_t>      m_row;
+        std::vector<uint8_t>       m_states;        // States of the cells of the row, once one is past the alive state
+        bool                       m_rowHasStates;
+
+        inline bool fail(std::string const& error) { m_error = error; return false; }
+
+        bool readRLEHeader();
+        bool readPlaintextHeader();
+        bool readMacrocell();
+
+        template<typename WriteRow> bool readRLERows(WriteRow& writeRow);
+        template<typename WriteRow> bool readPlaintextRows(WriteRow& writeRow);
+        template<typename WriteRow> bool readMacrocellRows(WriteRow& writeRow);
+
+        void addMacrocellRow(uint32_t id, uint64_t nodeX, uint64_t nodeY, uint64_t y);
+    };
+
+    inline PatternFormat PatternLoader::formatOf(std::string const& fileName)
+    {
+        auto endsWith = [&fileName](const char* extension)
+        {
+            const size_t length = std::char_traits<char>::length(extension);
+            return fileName.size() >= length && fileName.compare(fileName.size() - length, length, extension) == 0;
+        };
+        if (endsWith(".cells"))
+            return PatternFormat::Plaintext;
+        if (endsWith(".mc"))
+            return PatternFormat::Macrocell;
+        return PatternFormat::RLE;
+    }
+
+    inline bool PatternLoader::readHeader()
+    {
+        switch (m_format)
+        {
+            case PatternFormat::RLE:       return readRLEHeader();
+            case PatternFormat::Plaintext: return readPlaintextHeader();
+            case PatternFormat::Macrocell: return readMacrocell();
+        }
+        return false;
+    }
+
+    template<typename WriteRow>
+    bool PatternLoader::readRows(WriteRow&& writeRow)
+    {
+        m_row.assign((m_info.width + 63) / 64, 0);
+        switch (m_format)
+        {
+            case PatternFormat::RLE:       return readRLERows(writeRow);
+            case PatternFormat::Plaintext: return readPlaintextRows(writeRow);
+            case PatternFormat::Macrocell: return readMacrocellRows(writeRow);
+        }
+        return false;
+    }
+
+    inline bool PatternLoader::loadInto(IEngine& engine, size_t x, size_t y)
+    {
+        if (x + m_info.width > engine.getWidth() || y + m_info.height > engine.getHeight())
+            return fail("the pattern doesn't fit in the grid");
+
+        const size_t width = m_info.width;
+        bool hasTooManyStates = false;
+        const bool isRead = readRows([this, &engine, x, y, width, &hasTooManyStates](size_t row, uint64_t const* words)
+        {
+            if (!m_rowHasStates)
+            {
+                engine.setRowCells(x, y + row, words, width);
+                return;
+            }
+            for (size_t i = 0; i < width; i++)
+                if ((words[i / 64] >> (i % 64)) & 1)
+                    m_states[i] = 1;
+            if (!engine.setRowStates(x, y + row, m_states.data(), width))
+                hasTooManyStates = true;
+        });
+        if (isRead && hasTooManyStates)
+            return fail("the pattern has more than two states, which the engine can't run");
+        return isRead;
+    }
+
+    // ----------------------- RLE -----------------------------//
+    inline bool PatternLoader::readRLEHeader()
+    {
+        // Comment lines, then "x = <width>, y = <height>[, rule = <rule>]"
+        std::string line;
+        while (m_reader.readLine(line))
+        {
+            if (line.empty() || line[0] == '#')
+                continue;
+
+            bool hasWidth = false, hasHeight = false;
+            size_t begin = 0;
+            while (begin < line.size())
+            {
+                size_t end = line.find(',', begin);
+                if (end == std::string::npos)
+                    end = line.size();
+
+                const std::string field = line.substr(begin, end - begin);
+                const size_t equal = field.find('=');
+                if (equal != std::string::npos)
+                {
+                    std::string key   = field.substr(0, equal);
+                    std::string value = field.substr(equal + 1);
+                    key.erase(std::remove_if(key.begin(), key.end(), isSpace), key.end());
+                    value.erase(std::remove_if(value.begin(), value.end(), isSpace), value.end());
+
+                    if (key == "x")         { m_info.width  = std::strtoull(value.c_str(), nullptr, 10); hasWidth  = true; }
+                    else if (key == "y")    { m_info.height = std::strtoull(value.c_str(), nullptr, 10); hasHeight = true; }
+                    else if (key == "rule") { m_info.rule   = value; }
+                }
+                begin = end + 1;
+            }
+            if (!hasWidth || !hasHeight)
+                return fail("malformed RLE header : " + line);
+            return true;
+        }
+        return fail("missing RLE header");
+    }
+
+    template<typename WriteRow>
+    bool PatternLoader::readRLERows(WriteRow& writeRow)
+    {
+        size_t x = 0, y = 0;
+        auto endRow = [&]()
+        {
+            if (y < m_info.height)
+                writeRow(y, m_row.data());
+            std::fill(m_row.begin(), m_row.end(), 0);
+            if (m_rowHasStates)
+            {
+                std::fill(m_states.begin(), m_states.end(), 0);
+                m_rowHasStates = false;
+            }
+            y++;
+            x = 0;
+        };
+
+        for (int c = m_reader.peek(); c != EOF; c = m_reader.peek())
+        {
+            if (isSpace(c))
+            {
+                m_reader.get();
+                continue;
+            }
+
+            const size_t count = m_reader.readNumber(1);
+            while (isSpace(m_reader.peek()))
+                m_reader.get();
+            const int    tag   = m_reader.get();
+            if (tag == '!' || tag == EOF)
+                break;
+
+            switch (tag)
+            {
+                case '$':
+                    for (size_t i = 0; i < count; i++)
+                        endRow();
+                    break;
+                case 'b':
+                case '.':
+                    x += count;
+                    break;
+                default:
+                {
+                    // 'o' for two state rules, 'A' to 'X' with a 'p' to 'y' prefix for the states 1 to 255 of the others
+                    size_t state = 1;
+                    if (tag >= 'p' && tag <= 'y')
+                    {
+                        const int letter = m_reader.get();
+                        if (letter < 'A' || letter > 'X')
+                            return fail(std::string("unexpected character in RLE data : ") + static_cast<char>(tag));
+                        state = 24 * (tag - 'p' + 1) + (letter - 'A') + 1;
+                        if (state > 255)
+                            return fail(std::string("RLE state out of range : ") + static_cast<char>(tag) + static_cast<char>(letter));
+                    }
+                    else if (tag >= 'A' && tag <= 'X')
+                        state = tag - 'A' + 1;
+                    else if (tag != 'o')
+                        return fail(std::string("unexpected character in RLE data : ") + static_cast<char>(tag));
+                    if (x + count > m_info.width || y >= m_info.height)
+                        return fail("RLE data out of the bounds given by its header");
+
+                    if (state == 1)
+                        setBitRun(m_row.data(), x, count);
+                    else
+                    {
+                        if (m_states.empty())
+                            m_states.assign(m_info.width, 0);
+                        std::fill(m_states.begin() + x, m_states.begin() + x + count, static_cast<uint8_t>(state));
+                        m_rowHasStates = true;
+                    }
+                    x += count;
+                    break;
+                }
+            }
+        }
+
+        // The rows after the last one written are empty
+        while (y < m_info.height)
+            endRow();
+        return true;
+    }
+
+    // -------------------- PLAINTEXT --------------------------//
+    inline bool PatternLoader::readPlaintextHeader()
+    {
+        std::string line;
+        while (m_reader.readLine(line))
+        {
+            if (!line.empty() && line[0] == '!')
+                continue;
+            m_info.width = std::max(m_info.width, line.size());
+            m_info.height++;
+        }
+        m_reader.rewind();
+        return true;
+    }
+
+    template<typename WriteRow>
+    bool PatternLoader::readPlaintextRows(WriteRow& writeRow)
+    {
+        std::string line;
+        size_t y = 0;
+        while (y < m_info.height && m_reader.readLine(line))
+        {
+            if (!line.empty() && line[0] == '!')
+                continue;
+
+            std::fill(m_row.begin(), m_row.end(), 0);
+            for (size_t x = 0; x < line.size(); x++)
+                if (line[x] == 'O' || line[x] == '*')
+                    m_row[x / 64] |= uint64_t(1) << (x % 64);
+            writeRow(y++, m_row.data());
+        }
+        return true;
+    }
+
+    // -------------------- MACROCELL --------------------------//
+    inline bool PatternLoader::readMacrocell()
+    {
+        // Node 0 is the empty node, the others are numbered from 1 in the order of the file
+        m_nodes.assign(1, MacrocellNode{});
+
+        std::string line;
+        if (!m_reader.readLine(line) || line.compare(0, 2, "[M") != 0)
+            return fail("missing Macrocell header");
+
+        while (m_reader.readLine(line))
+        {
+            if (line.empty())
+                continue;
+            if (line[0] == '#')
+            {
+                if (line.compare(0, 3, "#R ") == 0)
+                    m_info.rule = line.substr(3);
+                continue;
+            }
+
+            MacrocellNode node = MacrocellNode{};
+            if (line[0] == '.' || line[0] == '*' || line[0] == '$')
+            {
+                // 8x8 leaf, rows ending with '$' and their trailing dead cells omitted
+                size_t x = 0, y = 0;
+                for (char c : line)
+                {
+                    if (c == '$')      { x = 0; y++; }
+                    else if (c == '*') { if (x < 8 && y < 8) node.leafRows |= uint64_t(1) << (x + 8 * y); x++; }
+                    else               { x++; }
+                }
+                node.level = 3;
+            }
+            else
+            {
+                unsigned long long level, nw, ne, sw, se;
+                if (std::sscanf(line.c_str(), "%llu %llu %llu %llu %llu", &level, &nw, &ne, &sw, &se) != 5)
+                    return fail("malformed Macrocell node : " + line);
+                if (level < 4 || level > 62)
+                    return fail("unsupported Macrocell node level : " + line);
+
+                const unsigned long long children[4] = { nw, ne, sw, se };
+                for (size_t i = 0; i < 4; i++)
+                {
+                    if (children[i] >= m_nodes.size() || (children[i] != 0 && m_nodes[children[i]].level != level - 1))
+                        return fail("invalid Macrocell child : " + line);
+                    node.children[i] = static_cast<uint32_t>(children[i]);
+                }
+                node.level = static_cast<uint32_t>(level);
+            }
+
+            // Bounding box of the alive cells relative to the node, minX > maxX if there is none
+            node.minX = node.minY = UINT64_MAX;
+            node.maxX = node.maxY = 0;
+            if (node.level == 3)
+            {
+                for (uint64_t i = 0; i < 64; i++)
+                {
+                    if ((node.leafRows >> i) & 1)
+                    {
+                        node.minX = std::min(node.minX, i % 8); node.maxX = std::max(node.maxX, i % 8);
+                        node.minY = std::min(node.minY, i / 8); node.maxY = std::max(node.maxY, i / 8);
+                    }
+                }
+            }
+            else
+            {
+                const uint64_t half = uint64_t(1) << (node.level - 1);
+                for (size_t i = 0; i < 4; i++)
+                {
+                    MacrocellNode const& child = m_nodes[node.children[i]];
+                    if (node.children[i] == 0 || child.minX > child.maxX)
+                        continue;
+                    const uint64_t offsetX = (i % 2) * half;
+                    const uint64_t offsetY = (i / 2) * half;
+                    node.minX = std::min(node.minX, offsetX + child.minX); node.maxX = std::max(node.maxX, offsetX + child.maxX);
+                    node.minY = std::min(node.minY, offsetY + child.minY); node.maxY = std::max(node.maxY, offsetY + child.maxY);
+                }
+            }
+            m_nodes.push_back(node);
+        }
+
+        if (m_nodes.size() < 2)
+            return fail("empty Macrocell pattern");
+
+        MacrocellNode const& root = m_nodes.back();
+        if (root.minX <= root.maxX)
+        {
+            m_info.width  = root.maxX - root.minX + 1;
+            m_info.height = root.maxY - root.minY + 1;
+        }
+        return true;
+    }
+
+    template<typename WriteRow>
+    bool PatternLoader::readMacrocellRows(WriteRow& writeRow)
+    {
+        const uint32_t rootId = static_cast<uint32_t>(m_nodes.size() - 1);
+        MacrocellNode const& root = m_nodes[rootId];
+        for (size_t y = 0; y < m_info.height; y++)
+        {
+            std::fill(m_row.begin(), m_row.end(), 0);
+            addMacrocellRow(rootId, 0, 0, root.minY + y);
+            writeRow(y, m_row.data());
+        }
+        return true;
+    }
+
+    // Adds the cells of the row y of the root that belong to the node at (nodeX, nodeY) to m_row
+    inline void PatternLoader::addMacrocellRow(uint32_t id, uint64_t nodeX, uint64_t nodeY, uint64_t y)
+    {
+        MacrocellNode const& node = m_nodes[id];
+        if (id == 0 || node.minX > node.maxX || y < nodeY + node.minY || y > nodeY + node.maxY)
+            return;
+
+        if (node.level == 3)
+        {
+            const uint64_t originX = m_nodes.back().minX;
+            uint64_t bits = (node.leafRows >> (8 * (y - nodeY))) & 0xFF;
+            if (nodeX < originX)
+            {
+                bits >>= originX - nodeX;
+                nodeX = originX;
+            }
+            const uint64_t x = nodeX - originX;
+            m_row[x / 64] |= bits << (x % 64);
+            if (x % 64 > 56 && (bits >> (64 - x % 64)) != 0)
+                m_row[x / 64 + 1] |= bits >> (64 - x % 64);
+            return;
+        }
+
+        const uint64_t half = uint64_t(1) << (node.level - 1);
+        if (y < nodeY + half)
+        {
+            addMacrocellRow(node.children[0], nodeX,        nodeY, y);
+            addMacrocellRow(node.children[1], nodeX + half, nodeY, y);
+        }
+        else
+        {
+            addMacrocellRow(node.children[2], nodeX,        nodeY + half, y);
+            addMacrocellRow(node.children[3], nodeX + half, nodeY + half, y);
+        }
+    }
+
+
+
+    // Reads the size and the rule of a pattern file, to choose the engine before loading it
+    inline bool readPatternInfo(std::string const& fileName, PatternInfo& info, std::string& error)
+    {
+        std::ifstream file(fileName, std::ios::binary);
+        if (!file)
+        {
+            error = "cannot open " + fileName;
+            return false;
+        }
+
+        PatternLoader loader(file, PatternLoader::formatOf(fileName));
+        if (!loader.readHeader())
+        {
+            error = loader.getError();
+            return false;
+        }
+        info = loader.getInfo();
+        return true;
+    }
+
+    // Clears the engine and loads the pattern file on the center of its grid.
+    // The rule of the pattern is set unless setsRule is false, the caller then setting its own.
+    inline bool loadPatternFile(std::string const& fileName, IEngine& engine, std::string& error, bool setsRule = true)
+    {
+        std::ifstream file(fileName, std::ios::binary);
+        if (!file)
+        {
+            error = "cannot open " + fileName;
+            return false;
+        }
+
+        PatternLoader loader(file, PatternLoader::formatOf(fileName));
+        if (!loader.readHeader())
+        {
+            error = loader.getError();
+            return false;
+        }
+
+        PatternInfo const& info = loader.getInfo();
+        if (info.width > engine.getWidth() || info.height > engine.getHeight())
+        {
+            error = "the pattern doesn't fit in the grid";
+            return false;
+        }
+
+        // Rules that aren't two state ones are left to the caller, which chooses the engine running them
+        Rule rule;
+        std::string ruleError;
+        if (setsRule && !info.rule.empty() && Rule::parse(info.rule, rule, ruleError) && !engine.setRule(rule))
+        {
+            error = "the engine can't run the rule " + info.rule + " of the pattern";
+            return false;
+        }
+
+        engine.clearCells();
+        if (!loader.loadInto(engine, (engine.getWidth() - info.width) / 2, (engine.getHeight() - info.height) / 2))
+        {
+            error = loader.getError();
+            return false;
+        }
+        return true;
+    }
+}
\ No newline at end of file
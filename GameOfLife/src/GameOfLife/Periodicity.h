@@ -0,0 +1,129 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "Base.h"
+
+namespace GameOfLife
+{
+    // Hash of the 64 cells of a word at the given position, 0 for empty words so that empty regions cost nothing.
+    // The hash of a grid is the sum of the hashes of its words : changing a word adds the difference of its two hashes.
+    inline uint64_t hashWord(size_t index, uint64_t word)
+    {
+        uint64_t hash = (word ^ (static_cast<uint64_t>(index) * 0x9E3779B97F4A7C15ull)) * 0xBF58476D1CE4E5B9ull;
+        hash = (hash ^ (hash >> 31)) * 0x94D049BB133111EBull;
+        return word != 0 ? hash ^ (hash >> 29) : 0;
+    }
+
+    // Remembers the hashes of the last maxPeriod generations, a generation hashing like one of them
+    // meaning that the cells settled into a still life (period 1) or an oscillator
+    class PeriodDetector final
+    {
+    public:
+        explicit PeriodDetector(uint32_t maxPeriod)
+            : m_hashes(std::max<uint32_t>(maxPeriod, 1)), m_lastGeneration(0), m_nbHashed(0),
+              m_period(0), m_settledGeneration(0) {}
+
+        // Returns true once settled. The generations must follow each other, the detection restarting otherwise.
+        bool record(uint64_t generation, uint64_t hash);
+
+        // To call when the cells were changed by other means than computing a generation
+        inline void reset()
+        {
+            m_nbHashed = 0;
+            m_period   = 0;
+        }
+
+        inline bool isSettled() const               { return m_period != 0; }
+        inline uint32_t getPeriod() const           { return m_period; }
+        inline uint64_t getSettledGeneration() const { return m_settledGeneration; }   // First generation of the cycle
+        inline uint32_t getMaxPeriod() const        { return static_cast<uint32_t>(m_hashes.size()); }
+
+    private:
+        std::vector<uint64_t> m_hashes;         // Indexed by the generation modulo maxPeriod
+        uint64_t              m_lastGeneration;
+        uint64_t              m_nbHashed;
+        uint32_t              m_period;
+        uint64_t              m_settledGeneration;
+    };
+
+    inline bool PeriodDetector::record(uint64_t generation, uint64_t hash)
+    {
+        if (m_nbHashed != 0 && generation != m_lastGeneration + 1)
+            reset();
+        if (m_period != 0)
+            return true;
+
+        // The shortest period is the one found first
+        const uint64_t maxPeriod = std::min<uint64_t>(m_nbHashed, m_hashes.size());
+        for (uint64_t period = 1; period <= maxPeriod; period++)
+            if (m_hashes[(generation - period) % m_hashes.size()] == hash)
+            {
+                m_period            = static_cast<uint32_t>(period);
+                m_settledGeneration = generation - period;
+                break;
+            }
+
+        m_hashes[generation % m_hashes.size()] = hash;
+        m_lastGeneration = generation;
+        m_nbHashed++;
+        return m_period != 0;
+    }
+
+    // Keeps the hash of the cells of an engine up to date, only reading the tiles changed since the last update
+    class StateHasher final
+    {
+    public:
+        StateHasher(size_t width, size_t height)
+            : m_width(width), m_height(height), m_rowWords((width + 63) / 64),
+              m_cells(m_rowWords * height, 0), m_row(m_rowWords), m_hash(0), m_isSynced(false) {}
+
+        // changes holds at least the cells changed since the previous update
+        uint64_t update(IEngine const& engine, ChangeSet const& changes);
+        inline uint64_t getHash() const { return m_hash; }
+
+    private:
+        size_t                m_width;
+        size_t                m_height;
+        size_t                m_rowWords;
+        std::vector<uint64_t> m_cells;          // Cells of the last update, 64 per word
+        std::vector<uint64_t> m_row;
+        uint64_t              m_hash;
+        bool                  m_isSynced;
+
+        void updateRows(IEngine const& engine, Rect const& cells);
+    };
+
+    inline uint64_t StateHasher::update(IEngine const& engine, ChangeSet const& changes)
+    {
+        if (m_isSynced)
+            changes.forEachRect([this, &engine](Rect const& cells) { updateRows(engine, cells); });
+        else
+            updateRows(engine, Rect{ 0, 0, m_width, m_height });
+        m_isSynced = true;
+        return m_hash;
+    }
+
+    inline void StateHasher::updateRows(IEngine const& engine, Rect const& cells)
+    {
+        // The changed tiles are 64 cells wide, so they start on a word
+        const size_t firstWord = cells.x / 64;
+        const size_t nbWords   = (cells.x + cells.width + 63) / 64 - firstWord;
+        for (size_t y = cells.y; y < cells.y + cells.height; y++)
+        {
+            engine.getRowCells(firstWord * 64, y, m_row.data(), std::min(nbWords * 64, m_width - firstWord * 64));
+
+            const size_t firstIndex = y * m_rowWords + firstWord;
+            for (size_t i = 0; i < nbWords; i++)
+            {
+                uint64_t& current = m_cells[firstIndex + i];
+                if (current == m_row[i])
+                    continue;
+                m_hash += hashWord(firstIndex + i, m_row[i]) - hashWord(firstIndex + i, current);
+                current = m_row[i];
+            }
+        }
+    }
+}
\ No newline at end of file
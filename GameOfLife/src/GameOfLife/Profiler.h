@@ -0,0 +1,302 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace GameOfLife
+{
+    // Parts of a frame and of a generation that are timed
+    enum class Stage : uint8_t
+    {
+        Frame,
+        Simulation,
+        Colors,
+        TextureUpdate,
+        Display,
+        Count
+    };
+
+    constexpr const char* stageNames[] = { "Frame", "Simulation", "Colors", "Texture update", "Display" };
+    constexpr size_t      nbStages     = static_cast<size_t>(Stage::Count);
+
+    // Durations of one stage on one thread, counted in 4 buckets per power of 2 of nanoseconds.
+    // Only its thread writes it, so relaxed atomics are enough for the others to read it meanwhile.
+    class LatencyHistogram final
+    {
+    public:
+        static constexpr size_t nbBuckets = 256;
+
+        LatencyHistogram()
+        {
+            for (std::atomic<uint64_t>& count : m_counts)
+                count.store(0, std::memory_order_relaxed);
+        }
+
+        inline void add(uint64_t nanoseconds)
+        {
+            std::atomic<uint64_t>& count = m_counts[bucketOf(nanoseconds)];
+            count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+        inline uint64_t getCount(size_t bucket) const { return m_counts[bucket].load(std::memory_order_relaxed); }
+
+        static inline size_t bucketOf(uint64_t nanoseconds)
+        {
+            if (nanoseconds < 4)
+                return static_cast<size_t>(nanoseconds);
+            size_t log2 = 0;
+            while ((nanoseconds >> log2) >= 8)
+                log2++;
+            // The 2 bits below the leading one select the bucket within its power of 2
+            return 4 * (log2 + 1) + static_cast<size_t>((nanoseconds >> log2) & 3);
+        }
+        // Middle of the durations of the bucket
+        static inline uint64_t bucketValue(size_t bucket)
+        {
+            if (bucket < 4)
+                return bucket;
+            const size_t log2 = bucket / 4 - 1;
+            return ((4 + bucket % 4) << log2) + ((uint64_t(1) << log2) >> 1);
+        }
+
+    private:
+        std::atomic<uint64_t> m_counts[nbBuckets];
+    };
+
+    struct TraceEvent
+    {
+        uint64_t start;         // Nanoseconds since the creation of the profiler
+        uint64_t duration;
+        Stage    stage;
+    };
+
+    // Timings of one thread : a histogram per stage, and the last events while tracing
+    class ThreadProfile final
+    {
+    public:
+        static constexpr size_t traceCapacity = 1 << 16;
+
+        ThreadProfile(std::string const& name, uint32_t id, std::chrono::steady_clock::time_point epoch,
+                      std::atomic<bool> const& isTracing)
+            : m_name(name), m_id(id), m_epoch(epoch), m_isTracing(isTracing), m_events(traceCapacity), m_nbEvents(0) {}
+
+        inline uint64_t now() const
+        {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_epoch).count());
+        }
+
+        inline void record(Stage stage, uint64_t start, uint64_t duration)
+        {
+            m_histograms[static_cast<size_t>(stage)].add(duration);
+            if (!m_isTracing.load(std::memory_order_relaxed))
+                return;
+
+            // The events wrap around, the exporting thread only reading those published before it started
+            const uint64_t index = m_nbEvents.load(std::memory_order_relaxed);
+            m_events[index % traceCapacity] = TraceEvent{ start, duration, stage };
+            m_nbEvents.store(index + 1, std::memory_order_release);
+        }
+
+        inline std::string const& getName() const                    { return m_name; }
+        inline uint32_t getId() const                                { return m_id; }
+        inline LatencyHistogram const& getHistogram(Stage stage) const { return m_histograms[static_cast<size_t>(stage)]; }
+
+        // Appends the recorded events, oldest first
+        void copyEvents(std::vector<TraceEvent>& events) const;
+
+    private:
+        std::string                            m_name;
+        uint32_t                               m_id;
+        std::chrono::steady_clock::time_point  m_epoch;
+        std::atomic<bool> const&               m_isTracing;
+        LatencyHistogram                       m_histograms[nbStages];
+        std::vector<TraceEvent>                m_events;
+        std::atomic<uint64_t>                  m_nbEvents;
+    };
+
+    inline void ThreadProfile::copyEvents(std::vector<TraceEvent>& events) const
+    {
+        // The oldest quarter may be overwritten while it is copied
+        const uint64_t nbEvents = m_nbEvents.load(std::memory_order_acquire);
+        const uint64_t first    = nbEvents > traceCapacity ? nbEvents - traceCapacity * 3 / 4 : 0;
+        for (uint64_t i = first; i < nbEvents; i++)
+            events.push_back(m_events[i % traceCapacity]);
+    }
+
+    // Gathers the timings of the threads that registered themselves.
+    // Recording takes no lock, only registering a thread and reading the timings do.
+    class Profiler final
+    {
+    public:
+        Profiler()
+            : m_epoch(std::chrono::steady_clock::now()), m_isTracing(false) {}
+
+        Profiler(Profiler const&) = delete;
+        Profiler& operator=(Profiler const&) = delete;
+
+        // Called once by every timed thread, the profile living as long as the profiler
+        ThreadProfile& registerThread(std::string const& name)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_profiles.emplace_back(new ThreadProfile(name, static_cast<uint32_t>(m_profiles.size()), m_epoch, m_isTracing));
+            return *m_profiles.back();
+        }
+
+        // The events recorded while tracing are kept, the last ones when there are too many
+        inline void setTracing(bool isTracing) { m_isTracing = isTracing; }
+        inline bool isTracing() const          { return m_isTracing; }
+
+        // Counts of every bucket of the stage, summed over the threads
+        void getCounts(Stage stage, std::vector<uint64_t>& counts) const;
+
+        // Writes the events to a JSON file in the Trace Event Format, which chrome://tracing and Perfetto open
+        bool writeChromeTrace(std::string const& fileName, std::string& error) const;
+
+    private:
+        std::chrono::steady_clock::time_point        m_epoch;
+        std::atomic<bool>                            m_isTracing;
+        mutable std::mutex                           m_mutex;
+        std::vector<std::unique_ptr<ThreadProfile>>  m_profiles;
+    };
+
+    inline void Profiler::getCounts(Stage stage, std::vector<uint64_t>& counts) const
+    {
+        counts.assign(LatencyHistogram::nbBuckets, 0);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (std::unique_ptr<ThreadProfile> const& profile : m_profiles)
+            for (size_t bucket = 0; bucket < LatencyHistogram::nbBuckets; bucket++)
+                counts[bucket] += profile->getHistogram(stage).getCount(bucket);
+    }
+
+    inline bool Profiler::writeChromeTrace(std::string const& fileName, std::string& error) const
+    {
+        std::ofstream file(fileName);
+        if (!file)
+        {
+            error = "can't open " + fileName;
+            return false;
+        }
+
+        // Microseconds, with the nanoseconds as decimals
+        auto microseconds = [](uint64_t nanoseconds)
+        {
+            std::string text = std::to_string(nanoseconds / 1000) + ".";
+            const std::string decimals = std::to_string(nanoseconds % 1000);
+            return text + std::string(3 - decimals.size(), '0') + decimals;
+        };
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        file << "{\"traceEvents\":[\n";
+        bool isFirst = true;
+        std::vector<TraceEvent> events;
+        for (std::unique_ptr<ThreadProfile> const& profile : m_profiles)
+        {
+            file << (isFirst ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << profile->getId()
+                 << ",\"args\":{\"name\":\"" << profile->getName() << "\"}}";
+            isFirst = false;
+
+            events.clear();
+            profile->copyEvents(events);
+            for (TraceEvent const& event : events)
+                file << ",\n{\"name\":\"" << stageNames[static_cast<size_t>(event.stage)] << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+                     << profile->getId() << ",\"ts\":" << microseconds(event.start) << ",\"dur\":" << microseconds(event.duration) << "}";
+        }
+        file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+        if (!file)
+        {
+            error = "can't write " + fileName;
+            return false;
+        }
+        return true;
+    }
+
+    // Records its lifetime as one occurrence of the stage, does nothing without a profile
+    class ScopedTimer final
+    {
+    public:
+        ScopedTimer(ThreadProfile* profile, Stage stage)
+            : m_profile(profile), m_stage(stage), m_start(profile ? profile->now() : 0) {}
+
+        ~ScopedTimer()
+        {
+            if (m_profile)
+                m_profile->record(m_stage, m_start, m_profile->now() - m_start);
+        }
+
+        ScopedTimer(ScopedTimer const&) = delete;
+        ScopedTimer& operator=(ScopedTimer const&) = delete;
+
+    private:
+        ThreadProfile* m_profile;
+        Stage          m_stage;
+        uint64_t       m_start;
+    };
+
+    // Percentiles of the durations of every stage recorded since the previous update
+    class StageStatistics final
+    {
+    public:
+        struct Percentiles
+        {
+            uint64_t count;
+            uint64_t p50;       // Nanoseconds
+            uint64_t p99;
+        };
+
+        StageStatistics()
+        {
+            for (std::vector<uint64_t>& counts : m_previousCounts)
+                counts.assign(LatencyHistogram::nbBuckets, 0);
+        }
+
+        void update(Profiler const& profiler);
+        inline Percentiles const& get(Stage stage) const { return m_percentiles[static_cast<size_t>(stage)]; }
+
+    private:
+        std::vector<uint64_t> m_previousCounts[nbStages];
+        std::vector<uint64_t> m_counts;
+        Percentiles           m_percentiles[nbStages] = {};
+    };
+
+    inline void StageStatistics::update(Profiler const& profiler)
+    {
+        for (size_t stage = 0; stage < nbStages; stage++)
+        {
+            profiler.getCounts(static_cast<Stage>(stage), m_counts);
+
+            uint64_t total = 0;
+            for (size_t bucket = 0; bucket < LatencyHistogram::nbBuckets; bucket++)
+            {
+                const uint64_t count = m_counts[bucket];
+                m_counts[bucket] -= m_previousCounts[stage][bucket];
+                m_previousCounts[stage][bucket] = count;
+                total += m_counts[bucket];
+            }
+
+            Percentiles& percentiles = m_percentiles[stage];
+            percentiles = Percentiles{ total, 0, 0 };
+            uint64_t seen = 0;
+            bool hasMedian = false;
+            for (size_t bucket = 0; bucket < LatencyHistogram::nbBuckets && total != 0; bucket++)
+            {
+                seen += m_counts[bucket];
+                if (!hasMedian && seen * 2 >= total)
+                {
+                    percentiles.p50 = LatencyHistogram::bucketValue(bucket);
+                    hasMedian = true;
+                }
+                if (seen * 100 >= total * 99)
+                {
+                    percentiles.p99 = LatencyHistogram::bucketValue(bucket);
+                    break;
+                }
+            }
+        }
+    }
+}
\ No newline at end of file
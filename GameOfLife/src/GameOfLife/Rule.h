@@ -0,0 +1,183 @@
+#pragma once
+
+#include <cctype>
+#include <cstdint>
+#include <string>
+
+#include "Macros.h"
+
+namespace GameOfLife
+{
+    // Outer totalistic rule of a two state automaton : whether a cell is alive in the next generation only
+    // depends on its state and on its number of alive neighbors
+    struct Rule
+    {
+        uint16_t birth;         // Bit n set when a dead cell with n alive neighbors becomes alive
+        uint16_t survival;      // Bit n set when an alive cell with n alive neighbors stays alive
+
+        // B3/S23 by default
+        constexpr Rule() : birth(1 << 3), survival((1 << 2) | (1 << 3)) {}
+        constexpr Rule(uint16_t birthMask, uint16_t survivalMask) : birth(birthMask), survival(survivalMask) {}
+
+        GOL_HOST_DEVICE inline bool nextState(bool isAlive, int nbNeighbors) const
+        {
+            return ((isAlive ? survival : birth) >> nbNeighbors) & 1;
+        }
+
+        // Some engines rely on empty regions staying empty
+        inline bool hasBirthWithoutNeighbors() const { return birth & 1; }
+
+        constexpr bool operator==(Rule const& other) const { return birth == other.birth && survival == other.survival; }
+        constexpr bool operator!=(Rule const& other) const { return !(*this == other); }
+
+        // "B3/S23" notation
+        std::string toString() const;
+
+        // Accepts "B3/S23", "b3s23", the older "23/3" survival/birth notation and the names of the common rules
+        static bool parse(std::string const& text, Rule& rule, std::string& error);
+    };
+
+    struct NamedRule
+    {
+        const char* name;
+        Rule        rule;
+    };
+
+    constexpr NamedRule namedRules[] = {
+        { "Life",               Rule(1 << 3,                                    (1 << 2) | (1 << 3)) },
+        { "HighLife",           Rule((1 << 3) | (1 << 6),                       (1 << 2) | (1 << 3)) },
+        { "DayAndNight",        Rule((1 << 3) | (1 << 6) | (1 << 7) | (1 << 8), (1 << 3) | (1 << 4) | (1 << 6) | (1 << 7) | (1 << 8)) },
+        { "Seeds",              Rule(1 << 2,                                    0) },
+        { "LifeWithoutDeath",   Rule(1 << 3,                                    0x1FF) },
+        { "Maze",               Rule(1 << 3,                                    (1 << 1) | (1 << 2) | (1 << 3) | (1 << 4) | (1 << 5)) },
+        { "Replicator",         Rule((1 << 1) | (1 << 3) | (1 << 5) | (1 << 7), (1 << 1) | (1 << 3) | (1 << 5) | (1 << 7)) },
+    };
+
+    inline std::string Rule::toString() const
+    {
+        std::string text = "B";
+        for (int n = 0; n <= 8; n++)
+            if ((birth >> n) & 1)
+                text += static_cast<char>('0' + n);
+        text += "/S";
+        for (int n = 0; n <= 8; n++)
+            if ((survival >> n) & 1)
+                text += static_cast<char>('0' + n);
+        return text;
+    }
+
+    inline bool Rule::parse(std::string const& text, Rule& rule, std::string& error)
+    {
+        std::string lower;
+        for (char c : text)
+            if (!std::isspace(static_cast<unsigned char>(c)))
+                lower += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+
+        for (NamedRule const& named : namedRules)
+        {
+            std::string name;
+            for (char const* c = named.name; *c; c++)
+                name += static_cast<char>(std::tolower(static_cast<unsigned char>(*c)));
+            if (lower == name)
+            {
+                rule = named.rule;
+                return true;
+            }
+        }
+
+        if (lower.empty())
+        {
+            error = "empty rule";
+            return false;
+        }
+
+        // Without letters, the counts before the slash are the survival ones
+        const bool hasLetters = lower.find_first_of("bs") != std::string::npos;
+        uint16_t masks[2] = { 0, 0 };      // birth, survival
+        int current = hasLetters ? -1 : 1;
+        int nbSlashes = 0;
+        for (char c : lower)
+        {
+            if (c == 'b')
+                current = 0;
+            else if (c == 's')
+                current = 1;
+            else if (c == '/' && ++nbSlashes == 1)
+            {
+                if (!hasLetters)
+                    current = 0;
+            }
+            else if (c >= '0' && c <= '8' && current >= 0)
+                masks[current] |= 1 << (c - '0');
+            else
+            {
+                error = "unsupported rule " + text;
+                return false;
+            }
+        }
+
+        rule = Rule(masks[0], masks[1]);
+        return true;
+    }
+
+
+
+    // --------------------- RULE KERNELS ----------------------//
+    // The engines are templated on the rule they run, with the common rules known at compile time so that
+    // their kernels are specialized : nextState() of a StaticRule folds into a few comparisons.
+    template<uint16_t birthMask, uint16_t survivalMask>
+    struct StaticRule
+    {
+        static constexpr uint16_t birth    = birthMask;
+        static constexpr uint16_t survival = survivalMask;
+
+        GOL_HOST_DEVICE inline bool nextState(bool isAlive, int nbNeighbors) const
+        {
+            return ((isAlive ? survivalMask : birthMask) >> nbNeighbors) & 1;
+        }
+    };
+
+    using ConwayRule      = StaticRule<1 << 3,                                    (1 << 2) | (1 << 3)>;
+    using HighLifeRule    = StaticRule<(1 << 3) | (1 << 6),                       (1 << 2) | (1 << 3)>;
+    using DayAndNightRule = StaticRule<(1 << 3) | (1 << 6) | (1 << 7) | (1 << 8), (1 << 3) | (1 << 4) | (1 << 6) | (1 << 7) | (1 << 8)>;
+    using SeedsRule       = StaticRule<1 << 2,                                    0>;
+
+    // Any other rule, read from a lookup table indexed by the state and the number of alive neighbors
+    struct TableRule
+    {
+        uint16_t birth;
+        uint16_t survival;
+        uint8_t  next[2][9];
+
+        explicit TableRule(Rule const& rule)
+            : birth(rule.birth), survival(rule.survival)
+        {
+            for (int n = 0; n <= 8; n++)
+            {
+                next[0][n] = rule.nextState(false, n);
+                next[1][n] = rule.nextState(true,  n);
+            }
+        }
+
+        GOL_HOST_DEVICE inline bool nextState(bool isAlive, int nbNeighbors) const
+        {
+            return next[isAlive][nbNeighbors];
+        }
+    };
+
+    // Calls f with the StaticRule matching rule if it is a common one, or with its TableRule
+    template<typename F>
+    inline void dispatchRule(Rule const& rule, F&& f)
+    {
+        if (rule == Rule(ConwayRule::birth, ConwayRule::survival))
+            f(ConwayRule());
+        else if (rule == Rule(HighLifeRule::birth, HighLifeRule::survival))
+            f(HighLifeRule());
+        else if (rule == Rule(DayAndNightRule::birth, DayAndNightRule::survival))
+            f(DayAndNightRule());
+        else if (rule == Rule(SeedsRule::birth, SeedsRule::survival))
+            f(SeedsRule());
+        else
+            f(TableRule(rule));
+    }
+}
\ No newline at end of file
@@ -0,0 +1,267 @@
+#pragma once
+
+#include <cstdint>
+
+#include "CPUImplentation.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define GOL_SIMD_X86
+    #include <immintrin.h>
+    #if defined(_MSC_VER) && !defined(__clang__)
+        #include <intrin.h>
+        #define GOL_TARGET_SSE2
+        #define GOL_TARGET_AVX2
+    #else
+        #define GOL_TARGET_SSE2 __attribute__((target("sse2")))
+        #define GOL_TARGET_AVX2 __attribute__((target("avx2")))
+    #endif
+#elif defined(__aarch64__) || defined(_M_ARM64) || defined(__ARM_NEON)
+    #define GOL_SIMD_NEON
+    #include <arm_neon.h>
+#endif
+
+namespace GameOfLife
+{
+    // The kernels read the bool cells as bytes holding 0 or 1
+    static_assert(sizeof(bool) == 1, "SIMD kernels expect one byte per cell");
+
+    // Builds the next states of the cells x in [begin, end) of a row, given the row and the rows above and below.
+    // The cells x - 1 and x + 1 have to be in the row : the wraparound is handled by the caller.
+    using row_kernel_t = void (*)(uint8_t const* top, uint8_t const* mid, uint8_t const* bot,
+                                  uint8_t* out, size_t begin, size_t end);
+
+    struct RowKernel
+    {
+        const char*  name;
+        row_kernel_t function;
+    };
+
+    template<typename RuleT = ConwayRule>
+    inline uint8_t nextCellState(uint8_t const* top, uint8_t const* mid, uint8_t const* bot,
+                                 size_t left, size_t x, size_t right, RuleT const& rule = RuleT())
+    {
+        const int nbNeighbors = top[left] + top[x] + top[right]
+                              + mid[left]          + mid[right]
+                              + bot[left] + bot[x] + bot[right];
+        return rule.nextState(mid[x], nbNeighbors);
+    }
+
+    template<typename RuleT>
+    inline void ruleRowKernel(uint8_t const* top, uint8_t const* mid, uint8_t const* bot,
+                              uint8_t* out, size_t begin, size_t end, RuleT const& rule)
+    {
+        for (size_t x = begin; x < end; x++)
+            out[x] = nextCellState(top, mid, bot, x - 1, x, x + 1, rule);
+    }
+
+    inline void scalarRowKernel(uint8_t const* top, uint8_t const* mid, uint8_t const* bot,
+                                uint8_t* out, size_t begin, size_t end)
+    {
+        ruleRowKernel(top, mid, bot, out, begin, end, ConwayRule());
+    }
+
+#ifdef GOL_SIMD_X86
+    GOL_TARGET_SSE2
+    inline void sse2RowKernel(uint8_t const* top, uint8_t const* mid, uint8_t const* bot,
+                              uint8_t* out, size_t begin, size_t end)
+    {
+        const __m128i one   = _mm_set1_epi8(1);
+        const __m128i two   = _mm_set1_epi8(2);
+        const __m128i three = _mm_set1_epi8(3);
+
+        size_t x = begin;
+        for (; x + 16 <= end; x += 16)
+        {
+            #define GOL_LOAD(ROW, OFFSET) _mm_loadu_si128(reinterpret_cast<__m128i const*>(ROW + x + OFFSET))
+            __m128i count = _mm_add_epi8(_mm_add_epi8(GOL_LOAD(top, -1), GOL_LOAD(top, 0)), GOL_LOAD(top, 1));
+            count = _mm_add_epi8(count, _mm_add_epi8(GOL_LOAD(mid, -1), GOL_LOAD(mid, 1)));
+            count = _mm_add_epi8(count, _mm_add_epi8(_mm_add_epi8(GOL_LOAD(bot, -1), GOL_LOAD(bot, 0)), GOL_LOAD(bot, 1)));
+            const __m128i alive = GOL_LOAD(mid, 0);
+            #undef GOL_LOAD
+
+            const __m128i born    = _mm_and_si128(_mm_cmpeq_epi8(count, three), one);
+            const __m128i survive = _mm_and_si128(_mm_cmpeq_epi8(count, two), alive);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x), _mm_or_si128(born, survive));
+        }
+        scalarRowKernel(top, mid, bot, out, x, end);
+    }
+
+    GOL_TARGET_AVX2
+    inline void avx2RowKernel(uint8_t const* top, uint8_t const* mid, uint8_t const* bot,
+                              uint8_t* out, size_t begin, size_t end)
+    {
+        const __m256i one   = _mm256_set1_epi8(1);
+        const __m256i two   = _mm256_set1_epi8(2);
+        const __m256i three = _mm256_set1_epi8(3);
+
+        size_t x = begin;
+        for (; x + 32 <= end; x += 32)
+        {
+            #define GOL_LOAD(ROW, OFFSET) _mm256_loadu_si256(reinterpret_cast<__m256i const*>(ROW + x + OFFSET))
+            __m256i count = _mm256_add_epi8(_mm256_add_epi8(GOL_LOAD(top, -1), GOL_LOAD(top, 0)), GOL_LOAD(top, 1));
+            count = _mm256_add_epi8(count, _mm256_add_epi8(GOL_LOAD(mid, -1), GOL_LOAD(mid, 1)));
+            count = _mm256_add_epi8(count, _mm256_add_epi8(_mm256_add_epi8(GOL_LOAD(bot, -1), GOL_LOAD(bot, 0)), GOL_LOAD(bot, 1)));
+            const __m256i alive = GOL_LOAD(mid, 0);
+            #undef GOL_LOAD
+
+            const __m256i born    = _mm256_and_si256(_mm256_cmpeq_epi8(count, three), one);
+            const __m256i survive = _mm256_and_si256(_mm256_cmpeq_epi8(count, two), alive);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + x), _mm256_or_si256(born, survive));
+        }
+        scalarRowKernel(top, mid, bot, out, x, end);
+    }
+
+    inline bool cpuSupportsAVX2()
+    {
+    #if defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+            return false;
+        __cpuid(info, 1);
+        const bool osSavesYmm = (info[2] & (1 << 27)) && (_xgetbv(0) & 0x6) == 0x6;
+        __cpuidex(info, 7, 0);
+        return osSavesYmm && (info[1] & (1 << 5));
+    #else
+        return __builtin_cpu_supports("avx2");
+    #endif
+    }
+
+    inline bool cpuSupportsSSE2()
+    {
+    #if defined(_M_X64) || defined(__x86_64__)
+        return true;
+    #elif defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuid(info, 1);
+        return info[3] & (1 << 26);
+    #else
+        return __builtin_cpu_supports("sse2");
+    #endif
+    }
+#endif // GOL_SIMD_X86
+
+#ifdef GOL_SIMD_NEON
+    inline void neonRowKernel(uint8_t const* top, uint8_t const* mid, uint8_t const* bot,
+                              uint8_t* out, size_t begin, size_t end)
+    {
+        const uint8x16_t one   = vdupq_n_u8(1);
+        const uint8x16_t two   = vdupq_n_u8(2);
+        const uint8x16_t three = vdupq_n_u8(3);
+
+        size_t x = begin;
+        for (; x + 16 <= end; x += 16)
+        {
+            uint8x16_t count = vaddq_u8(vaddq_u8(vld1q_u8(top + x - 1), vld1q_u8(top + x)), vld1q_u8(top + x + 1));
+            count = vaddq_u8(count, vaddq_u8(vld1q_u8(mid + x - 1), vld1q_u8(mid + x + 1)));
+            count = vaddq_u8(count, vaddq_u8(vaddq_u8(vld1q_u8(bot + x - 1), vld1q_u8(bot + x)), vld1q_u8(bot + x + 1)));
+            const uint8x16_t alive = vld1q_u8(mid + x);
+
+            const uint8x16_t born    = vandq_u8(vceqq_u8(count, three), one);
+            const uint8x16_t survive = vandq_u8(vceqq_u8(count, two), alive);
+            vst1q_u8(out + x, vorrq_u8(born, survive));
+        }
+        scalarRowKernel(top, mid, bot, out, x, end);
+    }
+#endif // GOL_SIMD_NEON
+
+    // Picks the widest instruction set available on the running CPU
+    inline RowKernel selectRowKernel()
+    {
+    #ifdef GOL_SIMD_X86
+        if (cpuSupportsAVX2())
+            return { "AVX2", avx2RowKernel };
+        if (cpuSupportsSSE2())
+            return { "SSE2", sse2RowKernel };
+    #endif
+    #ifdef GOL_SIMD_NEON
+        return { "NEON", neonRowKernel };
+    #endif
+        return { "scalar", scalarRowKernel };
+    }
+
+    // The vectorized kernels only run B3/S23, the other rules going through the scalar one
+    inline void runRowKernel(RowKernel const& kernel, uint8_t const* top, uint8_t const* mid, uint8_t const* bot,
+                             uint8_t* out, size_t begin, size_t end, ConwayRule const&)
+    {
+        kernel.function(top, mid, bot, out, begin, end);
+    }
+
+    template<typename RuleT>
+    inline void runRowKernel(RowKernel const&, uint8_t const* top, uint8_t const* mid, uint8_t const* bot,
+                             uint8_t* out, size_t begin, size_t end, RuleT const& rule)
+    {
+        ruleRowKernel(top, mid, bot, out, begin, end, rule);
+    }
+
+
+
+    // -------------------- SIMD CPU ENGINE --------------------//
+    // Same storage as CPUEngine, the interior of each row being computed by a vectorized kernel
+    // and only the first and last cells of the row wrapping around.
+    template<size_t sideLength>
+    class SIMDCPUEngine : public CPUEngine<sideLength>
+    {
+    public:
+        SIMDCPUEngine()
+            : CPUEngine<sideLength>(), m_rowKernel(selectRowKernel())
+        {
+            GOL_LOG("SIMD row kernel : " << m_rowKernel.name);
+        }
+        SIMDCPUEngine(cell_states_t<sideLength>&& initial_states)
+            : CPUEngine<sideLength>(std::move(initial_states)), m_rowKernel(selectRowKernel())
+        {
+            GOL_LOG("SIMD row kernel : " << m_rowKernel.name);
+        }
+
+        inline const char* getRowKernelName() const { return m_rowKernel.name; }
+
+        void computeNextGeneration() override;
+
+    private:
+        RowKernel m_rowKernel;
+
+        template<typename RuleT>
+        void computeRows(RuleT const& rule);
+    };
+
+    template<size_t sideLength>
+    void SIMDCPUEngine<sideLength>::computeNextGeneration()
+    {
+        dispatchRule(this->m_rule, [this](auto const& rule) { computeRows(rule); });
+
+        // Makes the new generation the current generation
+        std::swap(this->m_cellStates, this->m_nextCellStates);
+    }
+
+    template<size_t sideLength>
+    template<typename RuleT>
+    void SIMDCPUEngine<sideLength>::computeRows(RuleT const& rule)
+    {
+        uint8_t const* cells = reinterpret_cast<uint8_t const*>(this->m_cellStates.get());
+        uint8_t*       next  = reinterpret_cast<uint8_t*>(this->m_nextCellStates.get());
+
+        // Builds the next states on m_nextCellStates
+        for (size_t y = 0; y < sideLength; y++)
+        {
+            const size_t topY = y == 0 ? sideLength - 1 : y - 1;
+            const size_t botY = y == sideLength - 1 ? 0 : y + 1;
+
+            uint8_t const* top = cells + topY * sideLength;
+            uint8_t const* mid = cells + y    * sideLength;
+            uint8_t const* bot = cells + botY * sideLength;
+            uint8_t*       out = next  + y    * sideLength;
+
+            if (sideLength > 2)
+                runRowKernel(m_rowKernel, top, mid, bot, out, 1, sideLength - 1, rule);
+
+            // The first and last cells of the row wrap around
+            out[0] = nextCellState(top, mid, bot, sideLength - 1, 0, sideLength > 1 ? 1 : 0, rule);
+            if (sideLength > 1)
+                out[sideLength - 1] = nextCellState(top, mid, bot, sideLength - 2, sideLength - 1, 0, rule);
+
+            if (this->m_trackChanges)
+                this->m_changes.markRow(y, mid, out);
+        }
+    }
+}
\ No newline at end of file
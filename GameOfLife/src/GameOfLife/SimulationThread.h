@@ -0,0 +1,432 @@
+#pragma once
+
+#include <atomic>
+#include <bitset>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Base.h"
+#include "History.h"
+#include "Periodicity.h"
+#include "Profiler.h"
+#include "TripleBuffer.h"
+
+namespace GameOfLife
+{
+    struct Snapshot
+    {
+        std::vector<uint8_t> colors;        // Colors of the viewport, sized for the whole grid
+        Viewport             viewport;
+        ChangeSet            changes;       // Cells changed since the previous snapshot, which was always taken before this one
+        uint64_t             generation;
+        CellCoordinates      origin;        // Origin of the frame of an unbounded engine when the colors were computed
+    };
+
+    // Runs the engine and its view on their own thread, the colors of the completed generations
+    // being handed to the render loop through a triple buffer.
+    // The engine must only be modified through post() while the thread is running.
+    class SimulationThread final
+    {
+    public:
+        using command_t = std::function<void(IEngine&)>;
+
+        // With a positive generationsPerFrame, that many generations are computed for every snapshot taken by the render loop.
+        // With 0, generations are computed as fast as possible.
+        // firstGeneration is the number of the generation the engine holds, when resuming a run.
+        // With a profiler, the generations and the colors are timed on a thread of their own.
+        SimulationThread(IEngine& engine, IView& view, uint32_t generationsPerFrame = 1, uint64_t firstGeneration = 0,
+                         Profiler* profiler = nullptr)
+            : m_engine(engine), m_view(view), m_profiler(profiler), m_profile(nullptr),
+              m_snapshots(Snapshot{ std::vector<uint8_t>(engine.getWidth() * engine.getHeight() * 4), Viewport(),
+                                    ChangeSet(engine.getWidth(), engine.getHeight()), 0, engine.getOrigin() }),
+              m_viewport{ 0, 0, engine.getWidth(), engine.getHeight(), 1, Pooling::Max }, m_viewportChanged(false),
+              m_running(false), m_stopping(false), m_generationsPerFrame(generationsPerFrame),
+              m_generation(firstGeneration), m_dirty(true),
+              m_isRecording(false), m_oldestRecorded(0), m_newestRecorded(0),
+              m_stopWhenSettled(false), m_isDetecting(false), m_detectedPeriod(0), m_settledGeneration(0), m_pendingSteps(0),
+              m_isCountingPopulation(false), m_population(0), m_lastCount(std::chrono::steady_clock::time_point())
+        {
+            for (ChangeSet& changes : m_slotChanges)
+                changes = ChangeSet(engine.getWidth(), engine.getHeight());
+            m_changes        = ChangeSet(engine.getWidth(), engine.getHeight());
+            m_pendingChanges = ChangeSet(engine.getWidth(), engine.getHeight());
+            m_historyChanges = ChangeSet(engine.getWidth(), engine.getHeight());
+            m_detectionChanges = ChangeSet(engine.getWidth(), engine.getHeight());
+            m_engine.setChangeTracking(true);
+
+            m_thread = std::thread([this] { loop(); });
+        }
+
+        ~SimulationThread()
+        {
+            m_stopping = true;
+            wakeUp();
+            m_thread.join();
+            m_engine.setChangeTracking(false);
+        }
+
+        SimulationThread(SimulationThread const&) = delete;
+        SimulationThread& operator=(SimulationThread const&) = delete;
+
+        // Never blocks : returns the latest completed snapshot, or nullptr if there is none since the last call
+        inline Snapshot const* takeLatest()
+        {
+            if (!m_snapshots.update())
+                return nullptr;
+            wakeUp();
+            return &m_snapshots.front();
+        }
+
+        // Runs the command on the simulation thread, between two generations
+        inline void post(command_t command)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_commands.push_back(std::move(command));
+            }
+            wakeUp();
+        }
+
+        inline bool isRunning() const { return m_running; }
+        inline void setRunning(bool running)                        { m_running = running; wakeUp(); }
+        inline uint32_t getGenerationsPerFrame() const              { return m_generationsPerFrame; }
+        inline void setGenerationsPerFrame(uint32_t generations)    { m_generationsPerFrame = generations; wakeUp(); }
+        inline uint64_t getGeneration() const                       { return m_generation; }
+
+        // Computes one generation after the pending commands, without counting as a change of the cells
+        inline void step()
+        {
+            m_pendingSteps++;
+            wakeUp();
+        }
+
+        // Records every generation computed from now on, see HistoryRecorder
+        inline void startHistory(size_t maxBytes, uint32_t keyframeInterval)
+        {
+            post([this, maxBytes, keyframeInterval](IEngine& engine)
+            {
+                m_history.reset(new HistoryRecorder(engine.getWidth(), engine.getHeight(), maxBytes, keyframeInterval));
+                m_isRecording = true;
+                collectChanges();
+                record();
+            });
+        }
+        inline void stopHistory()
+        {
+            post([this](IEngine&)
+            {
+                m_history.reset();
+                m_isRecording = false;
+            });
+        }
+        inline bool isRecordingHistory() const      { return m_isRecording; }
+        inline uint64_t getOldestRecorded() const   { return m_oldestRecorded; }
+        inline uint64_t getNewestRecorded() const   { return m_newestRecorded; }
+
+        // Goes back, or forward, to a recorded generation. Computing a generation from there discards the later ones.
+        inline void restore(uint64_t generation)
+        {
+            post([this, generation](IEngine& engine)
+            {
+                if (m_history && m_history->restore(generation, engine))
+                    m_generation = generation;
+            });
+        }
+
+        // Hashes every generation computed from now on to detect when the cells settle into a still life
+        // or an oscillator of at most maxPeriod generations, pausing the simulation then if asked to
+        inline void startDetection(uint32_t maxPeriod, bool stopWhenSettled)
+        {
+            post([this, maxPeriod, stopWhenSettled](IEngine& engine)
+            {
+                m_hasher.reset(new StateHasher(engine.getWidth(), engine.getHeight()));
+                m_detector.reset(new PeriodDetector(maxPeriod));
+                m_stopWhenSettled = stopWhenSettled;
+                m_isDetecting = true;
+            });
+        }
+        inline void stopDetection()
+        {
+            post([this](IEngine&)
+            {
+                m_hasher.reset();
+                m_detector.reset();
+                m_isDetecting = false;
+                m_detectedPeriod = 0;
+            });
+        }
+        inline bool isDetecting() const                 { return m_isDetecting; }
+        inline uint32_t getDetectedPeriod() const       { return m_detectedPeriod; }     // 0 until settled
+        inline uint64_t getSettledGeneration() const    { return m_settledGeneration; }
+
+        // Counts the alive cells when publishing a snapshot, at most every populationInterval since it reads the whole grid
+        inline void setPopulationCounting(bool isCounting)  { m_isCountingPopulation = isCounting; wakeUp(); }
+        inline uint64_t getPopulation() const               { return m_population; }
+
+        // Region of the grid the next snapshots are colored for
+        inline void setViewport(Viewport const& viewport)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (viewport == m_viewport)
+                    return;
+                m_viewport = viewport;
+                m_viewportChanged = true;
+            }
+            wakeUp();
+        }
+
+    private:
+        IEngine&                  m_engine;
+        IView&                    m_view;
+        Profiler*                 m_profiler;
+        ThreadProfile*            m_profile;        // Registered by the thread itself
+        TripleBuffer<Snapshot>    m_snapshots;
+        // Cells changed since each slot of m_snapshots was last colored
+        ChangeSet                 m_slotChanges[TripleBuffer<Snapshot>::slotCount];
+
+        std::thread               m_thread;
+        std::mutex                m_mutex;
+        std::condition_variable   m_wakeUp;
+        std::vector<command_t>    m_commands;
+        Viewport                  m_viewport;
+        bool                      m_viewportChanged;
+
+        std::atomic<bool>         m_running;
+        std::atomic<bool>         m_stopping;
+        std::atomic<uint32_t>     m_generationsPerFrame;
+        std::atomic<uint64_t>     m_generation;
+        bool                      m_dirty;
+
+        // Cells changed since the last snapshot, and since the last generation recorded in m_history
+        ChangeSet                 m_changes;
+        ChangeSet                 m_pendingChanges;
+        ChangeSet                 m_historyChanges;
+        std::unique_ptr<HistoryRecorder> m_history;
+        std::atomic<bool>         m_isRecording;
+        std::atomic<uint64_t>     m_oldestRecorded;
+        std::atomic<uint64_t>     m_newestRecorded;
+
+        // Hash of the cells and period detection, m_detectionChanges holding the cells changed since the last hash
+        ChangeSet                 m_detectionChanges;
+        std::unique_ptr<StateHasher>    m_hasher;
+        std::unique_ptr<PeriodDetector> m_detector;
+        bool                      m_stopWhenSettled;
+        std::atomic<bool>         m_isDetecting;
+        std::atomic<uint32_t>     m_detectedPeriod;
+        std::atomic<uint64_t>     m_settledGeneration;
+        std::atomic<uint32_t>     m_pendingSteps;
+
+        static constexpr std::chrono::milliseconds populationInterval{ 250 };
+        std::atomic<bool>         m_isCountingPopulation;
+        std::atomic<uint64_t>     m_population;
+        std::chrono::steady_clock::time_point m_lastCount;
+        std::vector<uint64_t>     m_row;
+
+        inline void wakeUp() { m_wakeUp.notify_one(); }
+
+        void collectChanges();
+        void advance(uint32_t generations);
+        void record();
+        bool detect();
+        bool runCommands();
+        void countPopulation();
+        void publish();
+        void loop();
+    };
+
+    // Gathers the cells changed by the engine since the last call, for the snapshots, the history and the detection
+    inline void SimulationThread::collectChanges()
+    {
+        m_changes.clear();
+        if (!m_engine.collectChanges(m_changes))
+            m_changes.markAll();
+        m_pendingChanges.merge(m_changes);
+        if (m_history)
+            m_historyChanges.merge(m_changes);
+        if (m_detector)
+            m_detectionChanges.merge(m_changes);
+    }
+
+    // While recording the history or detecting periods, the generations are computed one by one
+    inline void SimulationThread::advance(uint32_t generations)
+    {
+        ScopedTimer timer(m_profile, Stage::Simulation);
+        if (!m_history && !m_detector)
+        {
+            m_engine.advance(generations);
+            m_generation += generations;
+            return;
+        }
+        for (uint32_t i = 0; i < generations; i++)
+        {
+            m_engine.computeNextGeneration();
+            m_generation++;
+            collectChanges();
+            if (m_history)
+                record();
+            if (m_detector && detect() && m_stopWhenSettled)
+            {
+                m_running = false;
+                break;
+            }
+        }
+    }
+
+    // Returns true on the generation the cells settle
+    inline bool SimulationThread::detect()
+    {
+        // The frame of an unbounded plane isn't the whole state, a glider leaving it would look settled,
+        // and neither are the alive cells of a rule with dying states
+        uint64_t hash;
+        if (!m_engine.hashCells(hash))
+            hash = m_hasher->update(m_engine, m_detectionChanges);
+        m_detectionChanges.clear();
+        if (!m_detector->record(m_generation, hash) || m_detectedPeriod != 0)
+            return false;
+
+        m_settledGeneration = m_detector->getSettledGeneration();
+        m_detectedPeriod    = m_detector->getPeriod();
+        return true;
+    }
+
+    inline void SimulationThread::record()
+    {
+        m_history->record(m_engine, m_generation, m_historyChanges);
+        m_historyChanges.clear();
+        m_oldestRecorded = m_history->getOldestGeneration();
+        m_newestRecorded = m_history->getNewestGeneration();
+    }
+
+    inline bool SimulationThread::runCommands()
+    {
+        std::vector<command_t> commands;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            commands.swap(m_commands);
+            if (m_viewportChanged)
+                m_dirty = true;
+            m_viewportChanged = false;
+        }
+        for (command_t const& command : commands)
+            command(m_engine);
+
+        // The generations computed before the commands may not lead to the cells after them
+        if (m_detector && !commands.empty())
+        {
+            collectChanges();
+            m_detector->reset();
+            m_detectedPeriod = 0;
+            detect();
+        }
+        return !commands.empty();
+    }
+
+    inline void SimulationThread::publish()
+    {
+        Viewport viewport;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            viewport = m_viewport;
+        }
+
+        Snapshot& snapshot = m_snapshots.back();
+        collectChanges();
+        std::swap(snapshot.changes, m_pendingChanges);
+        m_pendingChanges.clear();
+        for (ChangeSet& changes : m_slotChanges)
+            changes.merge(snapshot.changes);
+
+        // Only the pixels covering the cells changed since this slot was last colored are recomputed
+        ChangeSet& slotChanges = m_slotChanges[m_snapshots.backIndex()];
+        {
+            ScopedTimer timer(m_profile, Stage::Colors);
+            if (snapshot.viewport == viewport)
+                m_view.updateColors(viewport, slotChanges, snapshot.colors.data());
+            else
+            {
+                snapshot.viewport = viewport;
+                m_view.computeColors(viewport, snapshot.colors.data());
+            }
+        }
+        slotChanges.clear();
+        if (m_isCountingPopulation)
+            countPopulation();
+        snapshot.generation = m_generation;
+        snapshot.origin     = m_engine.getOrigin();
+        m_snapshots.publish();
+        m_dirty = false;
+    }
+
+    inline void SimulationThread::countPopulation()
+    {
+        const auto now = std::chrono::steady_clock::now();
+        if (now - m_lastCount < populationInterval)
+            return;
+        m_lastCount = now;
+
+        uint64_t population = 0;
+        if (m_engine.countPopulation(population))
+        {
+            m_population = population;
+            return;
+        }
+
+        const size_t width = m_engine.getWidth();
+        m_row.resize((width + 63) / 64);
+        for (size_t y = 0; y < m_engine.getHeight(); y++)
+        {
+            m_engine.getRowCells(0, y, m_row.data(), width);
+            for (uint64_t word : m_row)
+                population += std::bitset<64>(word).count();
+        }
+        m_population = population;
+    }
+
+    inline void SimulationThread::loop()
+    {
+        if (m_profiler)
+            m_profile = &m_profiler->registerThread("Simulation");
+
+        while (!m_stopping)
+        {
+            if (runCommands())
+                m_dirty = true;
+            if (const uint32_t steps = m_pendingSteps.exchange(0))
+            {
+                advance(steps);
+                m_dirty = true;
+            }
+
+            // The colors are only computed once the render loop took the previous snapshot
+            const bool snapshotTaken = !m_snapshots.hasFresh();
+            const uint32_t generationsPerFrame = m_generationsPerFrame;
+            bool busy = false;
+            if (m_running && (generationsPerFrame == 0 || snapshotTaken))
+            {
+                advance(generationsPerFrame == 0 ? 1 : generationsPerFrame);
+                m_dirty = true;
+                busy = true;
+            }
+
+            if (m_dirty && snapshotTaken)
+                publish();
+
+            if (!busy)
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wakeUp.wait_for(lock, std::chrono::milliseconds(5), [this]
+                {
+                    return m_stopping || !m_commands.empty() || m_viewportChanged || m_pendingSteps != 0
+                        || (m_running && !m_snapshots.hasFresh());
+                });
+            }
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,634 @@
+#pragma once
+
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "Base.h"
+#include "BitPackedImplementation.h"
+#include "Periodicity.h"
+#include "ThreadPool.h"
+
+namespace GameOfLife
+{
+    // Rectangle of an unbounded plane, in world coordinates
+    struct WorldRect
+    {
+        int64_t  x;
+        int64_t  y;
+        uint64_t width;
+        uint64_t height;
+
+        inline bool isEmpty() const { return width == 0 || height == 0; }
+    };
+
+    // 64 x 64 cells of the plane, bit b of rows[parity][row] being the cell (64 * x + b, 64 * y + row).
+    // The rows of the current generation are those of the engine parity, the others receive the next one.
+    struct SparseTile
+    {
+        static constexpr size_t side = 64;
+
+        int64_t x;
+        int64_t y;
+        size_t  index;                  // Position in the list of tiles of the engine
+        word_t  rows[2][side];
+    };
+
+    // Floor of the division by the side of a tile, for negative coordinates too
+    inline int64_t tileCoordinate(int64_t cell) { return cell >> 6; }
+    inline size_t  cellInTile(int64_t cell)     { return static_cast<size_t>(cell & 63); }
+
+
+
+    // ----------------------- TILE POOL -----------------------//
+    // Allocates the tiles by chunks, the released ones being handed out again before a new chunk is allocated
+    class TilePool final
+    {
+    public:
+        explicit TilePool(size_t tilesPerChunk = 256)
+            : m_tilesPerChunk(tilesPerChunk) {}
+
+        TilePool(TilePool const&) = delete;
+        TilePool& operator=(TilePool const&) = delete;
+
+        inline SparseTile* allocate(int64_t x, int64_t y)
+        {
+            if (m_free.empty())
+            {
+                m_chunks.emplace_back(new SparseTile[m_tilesPerChunk]);
+                for (size_t i = m_tilesPerChunk; i-- > 0;)
+                    m_free.push_back(&m_chunks.back()[i]);
+            }
+
+            SparseTile* tile = m_free.back();
+            m_free.pop_back();
+            tile->x = x;
+            tile->y = y;
+            std::memset(tile->rows, 0, sizeof(tile->rows));
+            return tile;
+        }
+        inline void release(SparseTile* tile) { m_free.push_back(tile); }
+
+        inline size_t getCapacity() const { return m_chunks.size() * m_tilesPerChunk; }
+        inline size_t getFreeCount() const { return m_free.size(); }
+
+    private:
+        size_t                                     m_tilesPerChunk;
+        std::vector<std::unique_ptr<SparseTile[]>> m_chunks;
+        std::vector<SparseTile*>                   m_free;
+    };
+
+
+
+    // ------------------------ TILE MAP -----------------------//
+    // Hash map from the coordinates of the tiles to the tiles, with open addressing :
+    // linear probing, and erased slots filled by shifting the following ones back
+    class TileMap final
+    {
+    public:
+        TileMap() : m_slots(64), m_size(0) {}
+
+        inline size_t size() const { return m_size; }
+
+        inline SparseTile* find(int64_t x, int64_t y) const
+        {
+            for (size_t i = slotOf(x, y);; i = (i + 1) & (m_slots.size() - 1))
+            {
+                Slot const& slot = m_slots[i];
+                if (!slot.tile || (slot.x == x && slot.y == y))
+                    return slot.tile;
+            }
+        }
+
+        // The tile must not be in the map yet
+        inline void insert(SparseTile* tile)
+        {
+            // Kept at most half full
+            if (2 * (m_size + 1) > m_slots.size())
+                rehash(2 * m_slots.size());
+
+            size_t i = slotOf(tile->x, tile->y);
+            while (m_slots[i].tile)
+                i = (i + 1) & (m_slots.size() - 1);
+            m_slots[i] = Slot{ tile->x, tile->y, tile };
+            m_size++;
+        }
+
+        void erase(int64_t x, int64_t y);
+
+        inline void clear()
+        {
+            std::fill(m_slots.begin(), m_slots.end(), Slot{ 0, 0, nullptr });
+            m_size = 0;
+        }
+
+    private:
+        struct Slot
+        {
+            int64_t     x;
+            int64_t     y;
+            SparseTile* tile;
+        };
+
+        std::vector<Slot> m_slots;      // Power of 2 sized
+        size_t            m_size;
+
+        inline size_t slotOf(int64_t x, int64_t y) const
+        {
+            uint64_t hash = static_cast<uint64_t>(x) * 0x9E3779B97F4A7C15ull ^ static_cast<uint64_t>(y) * 0xC2B2AE3D27D4EB4Full;
+            hash ^= hash >> 29;
+            return static_cast<size_t>(hash) & (m_slots.size() - 1);
+        }
+
+        void rehash(size_t nbSlots);
+    };
+
+    inline void TileMap::erase(int64_t x, int64_t y)
+    {
+        const size_t mask = m_slots.size() - 1;
+        size_t hole = slotOf(x, y);
+        while (m_slots[hole].tile && (m_slots[hole].x != x || m_slots[hole].y != y))
+            hole = (hole + 1) & mask;
+        if (!m_slots[hole].tile)
+            return;
+
+        // The following slots of the run move back to the hole unless their own slot is between the hole and them
+        for (size_t i = (hole + 1) & mask; m_slots[i].tile; i = (i + 1) & mask)
+        {
+            const size_t home = slotOf(m_slots[i].x, m_slots[i].y);
+            if (((i - home) & mask) >= ((i - hole) & mask))
+            {
+                m_slots[hole] = m_slots[i];
+                hole = i;
+            }
+        }
+        m_slots[hole].tile = nullptr;
+        m_size--;
+    }
+
+    inline void TileMap::rehash(size_t nbSlots)
+    {
+        std::vector<Slot> slots(nbSlots, Slot{ 0, 0, nullptr });
+        slots.swap(m_slots);
+        m_size = 0;
+        for (Slot const& slot : slots)
+            if (slot.tile)
+                insert(slot.tile);
+    }
+
+
+
+    // --------------------- SPARSE ENGINE ---------------------//
+    // Runs a rule on an unbounded plane : only the tiles holding alive cells, and those next to their borders
+    // where cells may be born, are allocated. The tiles left empty by a generation are released.
+    // The IEngine cells are those of a width x height frame of the plane, whose top left cell is the origin.
+    class SparseEngine : public IEngine
+    {
+    public:
+        SparseEngine(size_t frameWidth, size_t frameHeight, size_t nbThreads = ThreadPool::defaultThreadCount())
+            : m_frameWidth(frameWidth), m_frameHeight(frameHeight), m_parity(0), m_boundsChanged(false),
+              m_bounds{ 0, 0, 0, 0 }, m_population(0), m_threadPool(nbThreads),
+              m_changes(frameWidth, frameHeight), m_trackChanges(false)
+        {
+            // Centered on the cell (0, 0)
+            setOrigin(CellCoordinates{ -static_cast<int64_t>(frameWidth / 2), -static_cast<int64_t>(frameHeight / 2) });
+        }
+
+        bool getCell(int64_t x, int64_t y) const
+        {
+            SparseTile const* tile = m_tiles.find(tileCoordinate(x), tileCoordinate(y));
+            return tile && ((tile->rows[m_parity][cellInTile(y)] >> cellInTile(x)) & 1);
+        }
+        void setCell(int64_t x, int64_t y, bool isAlive);
+
+        // Smallest rectangle holding the alive cells, empty without any
+        WorldRect getBoundingBox() const;
+        uint64_t  getPopulation() const;
+        inline size_t getTileCount() const      { return m_tileList.size(); }
+        inline TilePool const& getPool() const  { return m_pool; }
+
+        // Number of alive cells of the world row y in [xBegin, xEnd)
+        size_t countAlive(int64_t y, int64_t xBegin, int64_t xEnd) const;
+
+        size_t getWidth() const override  { return m_frameWidth; }
+        size_t getHeight() const override { return m_frameHeight; }
+
+        bool isUnbounded() const override            { return true; }
+        CellCoordinates getOrigin() const override   { return m_origin; }
+        void setOrigin(CellCoordinates origin) override;
+        bool hashCells(uint64_t& hash) const override;
+        bool countPopulation(uint64_t& population) const override { population = getPopulation(); return true; }
+
+        void setCellState(size_t x, size_t y, bool isAlive) override
+        {
+            setCell(m_origin.x + static_cast<int64_t>(x), m_origin.y + static_cast<int64_t>(y), isAlive);
+        }
+        void clearCells() override;
+        void getRowCells(size_t x, size_t y, uint64_t* words, size_t nbCells) const override;
+        void setRowCells(size_t x, size_t y, uint64_t const* words, size_t nbCells) override;
+        void computeNextGeneration() override;
+
+        // Rules giving birth without neighbors would fill the whole plane
+        bool setRule(Rule const& rule) override
+        {
+            if (rule.hasBirthWithoutNeighbors())
+                return false;
+            m_rule = rule;
+            return true;
+        }
+        Rule getRule() const override { return m_rule; }
+
+        void setChangeTracking(bool enabled) override
+        {
+            m_trackChanges = enabled;
+            m_changes.markAll();
+        }
+        bool collectChanges(ChangeSet& changes) override
+        {
+            if (!m_trackChanges)
+                return false;
+            changes.merge(m_changes);
+            m_changes.clear();
+            return true;
+        }
+
+    private:
+        size_t                   m_frameWidth;
+        size_t                   m_frameHeight;
+        CellCoordinates          m_origin;
+        Rule                     m_rule;
+
+        TilePool                 m_pool;
+        TileMap                  m_tiles;
+        std::vector<SparseTile*> m_tileList;
+        size_t                   m_parity;
+
+        mutable bool             m_boundsChanged;
+        mutable WorldRect        m_bounds;
+        mutable uint64_t         m_population;
+
+        ThreadPool               m_threadPool;
+        ChangeSet                m_changes;
+        bool                     m_trackChanges;
+
+        SparseTile* getOrAddTile(int64_t x, int64_t y);
+        void removeTile(SparseTile* tile);
+        void addBorderTiles(SparseTile const& tile);
+        void markTile(SparseTile const& tile);
+        template<typename RuleT>
+        void computeTile(SparseTile& tile, RuleT const& rule) const;
+    };
+
+    inline SparseTile* SparseEngine::getOrAddTile(int64_t x, int64_t y)
+    {
+        if (SparseTile* tile = m_tiles.find(x, y))
+            return tile;
+
+        SparseTile* tile = m_pool.allocate(x, y);
+        tile->index = m_tileList.size();
+        m_tileList.push_back(tile);
+        m_tiles.insert(tile);
+        return tile;
+    }
+
+    inline void SparseEngine::removeTile(SparseTile* tile)
+    {
+        m_tiles.erase(tile->x, tile->y);
+        m_tileList[tile->index] = m_tileList.back();
+        m_tileList[tile->index]->index = tile->index;
+        m_tileList.pop_back();
+        m_pool.release(tile);
+    }
+
+    // Marks the tiles of the frame the tile overlaps, the frame origin being anywhere
+    inline void SparseEngine::markTile(SparseTile const& tile)
+    {
+        if (!m_trackChanges)
+            return;
+
+        const int64_t x = tile.x * static_cast<int64_t>(SparseTile::side) - m_origin.x;
+        const int64_t y = tile.y * static_cast<int64_t>(SparseTile::side) - m_origin.y;
+        const int64_t side = static_cast<int64_t>(SparseTile::side);
+        if (x + side <= 0 || y + side <= 0 || x >= static_cast<int64_t>(m_frameWidth) || y >= static_cast<int64_t>(m_frameHeight))
+            return;
+
+        const size_t beginX = static_cast<size_t>(std::max<int64_t>(x, 0));
+        const size_t beginY = static_cast<size_t>(std::max<int64_t>(y, 0));
+        const size_t endX   = static_cast<size_t>(std::min<int64_t>(x + side, static_cast<int64_t>(m_frameWidth)));
+        const size_t endY   = static_cast<size_t>(std::min<int64_t>(y + side, static_cast<int64_t>(m_frameHeight)));
+        m_changes.markRect(Rect{ beginX, beginY, endX - beginX, endY - beginY });
+    }
+
+    inline void SparseEngine::setCell(int64_t x, int64_t y, bool isAlive)
+    {
+        const int64_t tileX = tileCoordinate(x);
+        const int64_t tileY = tileCoordinate(y);
+        SparseTile* tile = isAlive ? getOrAddTile(tileX, tileY) : m_tiles.find(tileX, tileY);
+        if (!tile)
+            return;
+
+        word_t& row = tile->rows[m_parity][cellInTile(y)];
+        const word_t bit = word_t(1) << cellInTile(x);
+        row = isAlive ? row | bit : row & ~bit;
+        m_boundsChanged = true;
+        markTile(*tile);
+    }
+
+    inline void SparseEngine::setOrigin(CellCoordinates origin)
+    {
+        m_origin = origin;
+        m_changes.markAll();
+    }
+
+    // The rows are hashed at the position of their tile, the tiles being in no particular order
+    inline bool SparseEngine::hashCells(uint64_t& hash) const
+    {
+        hash = 0;
+        for (SparseTile const* tile : m_tileList)
+        {
+            uint64_t key = static_cast<uint64_t>(tile->x) * 0x9E3779B97F4A7C15ull ^ static_cast<uint64_t>(tile->y) * 0xC2B2AE3D27D4EB4Full;
+            key = (key ^ (key >> 31)) * SparseTile::side;
+            for (size_t row = 0; row < SparseTile::side; row++)
+                hash += hashWord(static_cast<size_t>(key + row), tile->rows[m_parity][row]);
+        }
+        return true;
+    }
+
+    inline void SparseEngine::clearCells()
+    {
+        for (SparseTile* tile : m_tileList)
+            m_pool.release(tile);
+        m_tileList.clear();
+        m_tiles.clear();
+        m_boundsChanged = true;
+        m_changes.markAll();
+    }
+
+    inline size_t SparseEngine::countAlive(int64_t y, int64_t xBegin, int64_t xEnd) const
+    {
+        const int64_t tileY = tileCoordinate(y);
+        const size_t  row   = cellInTile(y);
+        size_t nbAlive = 0;
+        for (int64_t x = xBegin; x < xEnd;)
+        {
+            const size_t bit    = cellInTile(x);
+            const size_t nbBits = static_cast<size_t>(std::min<int64_t>(static_cast<int64_t>(SparseTile::side - bit), xEnd - x));
+            if (SparseTile const* tile = m_tiles.find(tileCoordinate(x), tileY))
+            {
+                const word_t mask = (nbBits == bitsPerWord ? ~word_t(0) : (word_t(1) << nbBits) - 1) << bit;
+                nbAlive += std::bitset<bitsPerWord>(tile->rows[m_parity][row] & mask).count();
+            }
+            x += static_cast<int64_t>(nbBits);
+        }
+        return nbAlive;
+    }
+
+    inline void SparseEngine::getRowCells(size_t x, size_t y, uint64_t* words, size_t nbCells) const
+    {
+        const int64_t worldX = m_origin.x + static_cast<int64_t>(x);
+        const int64_t worldY = m_origin.y + static_cast<int64_t>(y);
+        const int64_t tileY  = tileCoordinate(worldY);
+        const size_t  row    = cellInTile(worldY);
+        const size_t  shift  = cellInTile(worldX);
+
+        auto tileWord = [&](int64_t tileX)
+        {
+            SparseTile const* tile = m_tiles.find(tileX, tileY);
+            return tile ? tile->rows[m_parity][row] : word_t(0);
+        };
+
+        // Word i holds the end of a tile and the start of the next one
+        word_t next = tileWord(tileCoordinate(worldX));
+        for (size_t i = 0; i * bitsPerWord < nbCells; i++)
+        {
+            const word_t current = next;
+            next = shift != 0 || i * bitsPerWord + bitsPerWord < nbCells ? tileWord(tileCoordinate(worldX) + static_cast<int64_t>(i) + 1) : 0;
+            words[i] = shift == 0 ? current : (current >> shift) | (next << (bitsPerWord - shift));
+
+            const size_t nbBits = std::min(bitsPerWord, nbCells - i * bitsPerWord);
+            if (nbBits < bitsPerWord)
+                words[i] &= (word_t(1) << nbBits) - 1;
+        }
+    }
+
+    inline void SparseEngine::setRowCells(size_t x, size_t y, uint64_t const* words, size_t nbCells)
+    {
+        const int64_t worldX = m_origin.x + static_cast<int64_t>(x);
+        const int64_t worldY = m_origin.y + static_cast<int64_t>(y);
+        const int64_t tileY  = tileCoordinate(worldY);
+        const size_t  row    = cellInTile(worldY);
+
+        // One word per tile the row crosses, the tiles only receiving dead cells not being allocated
+        for (size_t i = 0; i < nbCells;)
+        {
+            const int64_t cellX  = worldX + static_cast<int64_t>(i);
+            const size_t  bit    = cellInTile(cellX);
+            const size_t  nbBits = std::min(SparseTile::side - bit, nbCells - i);
+            const word_t  mask   = nbBits == bitsPerWord ? ~word_t(0) : (word_t(1) << nbBits) - 1;
+
+            word_t bits;
+            copyBitsFromRow(words, i, &bits, nbBits);
+            SparseTile* tile = bits != 0 ? getOrAddTile(tileCoordinate(cellX), tileY) : m_tiles.find(tileCoordinate(cellX), tileY);
+            if (tile)
+            {
+                word_t& tileRow = tile->rows[m_parity][row];
+                tileRow = (tileRow & ~(mask << bit)) | (bits << bit);
+            }
+            i += nbBits;
+        }
+
+        m_boundsChanged = true;
+        if (m_trackChanges)
+            m_changes.markRect(Rect{ x, y, nbCells, 1 });
+    }
+
+    // Cells may be born on the other side of the alive cells of the borders
+    inline void SparseEngine::addBorderTiles(SparseTile const& tile)
+    {
+        word_t const* rows = tile.rows[m_parity];
+        word_t columns = 0;
+        for (size_t y = 0; y < SparseTile::side; y++)
+            columns |= rows[y];
+        if (columns == 0)
+            return;
+
+        const bool top       = rows[0] != 0;
+        const bool bottom    = rows[SparseTile::side - 1] != 0;
+        const bool leftSide  = (columns & 1) != 0;
+        const bool rightSide = (columns >> 63) != 0;
+
+        if (top)                                            getOrAddTile(tile.x,     tile.y - 1);
+        if (bottom)                                         getOrAddTile(tile.x,     tile.y + 1);
+        if (leftSide)                                       getOrAddTile(tile.x - 1, tile.y);
+        if (rightSide)                                      getOrAddTile(tile.x + 1, tile.y);
+        if (rows[0] & 1)                                    getOrAddTile(tile.x - 1, tile.y - 1);
+        if (rows[0] >> 63)                                  getOrAddTile(tile.x + 1, tile.y - 1);
+        if (rows[SparseTile::side - 1] & 1)                 getOrAddTile(tile.x - 1, tile.y + 1);
+        if (rows[SparseTile::side - 1] >> 63)               getOrAddTile(tile.x + 1, tile.y + 1);
+    }
+
+    template<typename RuleT>
+    inline void SparseEngine::computeTile(SparseTile& tile, RuleT const& rule) const
+    {
+        constexpr size_t side = SparseTile::side;
+        const size_t current = m_parity;
+
+        auto rowsOf = [this, current](int64_t x, int64_t y) -> word_t const*
+        {
+            SparseTile const* neighbor = m_tiles.find(x, y);
+            return neighbor ? neighbor->rows[current] : nullptr;
+        };
+        word_t const* topLeft  = rowsOf(tile.x - 1, tile.y - 1);
+        word_t const* top      = rowsOf(tile.x,     tile.y - 1);
+        word_t const* topRight = rowsOf(tile.x + 1, tile.y - 1);
+        word_t const* left     = rowsOf(tile.x - 1, tile.y);
+        word_t const* right    = rowsOf(tile.x + 1, tile.y);
+        word_t const* botLeft  = rowsOf(tile.x - 1, tile.y + 1);
+        word_t const* bot      = rowsOf(tile.x,     tile.y + 1);
+        word_t const* botRight = rowsOf(tile.x + 1, tile.y + 1);
+
+        // Rows -1 to 64 of the tile, with their cells shifted so that bit b holds the left and right neighbors of the cell b
+        word_t mid[side + 2], toLeft[side + 2], toRight[side + 2];
+        auto setRow = [&](size_t i, word_t const* westRows, word_t const* centerRows, word_t const* eastRows, size_t row)
+        {
+            const word_t center = centerRows ? centerRows[row] : 0;
+            const word_t west   = westRows   ? westRows[row] >> 63 : 0;
+            const word_t east   = eastRows   ? eastRows[row] & 1   : 0;
+            mid[i]     = center;
+            toLeft[i]  = (center << 1) | west;
+            toRight[i] = (center >> 1) | (east << 63);
+        };
+        setRow(0, topLeft, top, topRight, side - 1);
+        for (size_t y = 0; y < side; y++)
+            setRow(y + 1, left, tile.rows[current], right, y);
+        setRow(side + 1, botLeft, bot, botRight, 0);
+
+        word_t* out = tile.rows[current ^ 1];
+        for (size_t y = 0; y < side; y++)
+            out[y] = nextWordState(rule, mid[y + 1],
+                                   toLeft[y],     mid[y],     toRight[y],
+                                   toLeft[y + 1],             toRight[y + 1],
+                                   toLeft[y + 2], mid[y + 2], toRight[y + 2]);
+    }
+
+    inline void SparseEngine::computeNextGeneration()
+    {
+        // The tiles added for the borders are empty, they don't need neighbors of their own
+        const size_t nbTiles = m_tileList.size();
+        for (size_t i = 0; i < nbTiles; i++)
+            addBorderTiles(*m_tileList[i]);
+
+        // Every task builds the next rows of a range of tiles, the map only being read meanwhile
+        const size_t nbTasks = std::min(m_threadPool.size(), m_tileList.size());
+        dispatchRule(m_rule, [this, nbTasks](auto const& rule)
+        {
+            m_threadPool.parallelFor(nbTasks, [this, nbTasks, &rule](size_t task)
+            {
+                const size_t begin = task * m_tileList.size() / nbTasks;
+                const size_t end   = (task + 1) * m_tileList.size() / nbTasks;
+                for (size_t i = begin; i < end; i++)
+                    computeTile(*m_tileList[i], rule);
+            });
+        });
+
+        // Makes the new generation the current generation, and releases the tiles left empty
+        m_parity ^= 1;
+        for (size_t i = m_tileList.size(); i-- > 0;)
+        {
+            SparseTile* tile = m_tileList[i];
+            word_t const* rows = tile->rows[m_parity];
+            word_t const* previous = tile->rows[m_parity ^ 1];
+            if (std::memcmp(rows, previous, sizeof(tile->rows[0])) != 0)
+            {
+                markTile(*tile);
+                m_boundsChanged = true;
+            }
+            if (std::all_of(rows, rows + SparseTile::side, [](word_t row) { return row == 0; }))
+                removeTile(tile);
+        }
+    }
+
+    inline WorldRect SparseEngine::getBoundingBox() const
+    {
+        if (!m_boundsChanged)
+            return m_bounds;
+
+        constexpr int64_t side = static_cast<int64_t>(SparseTile::side);
+        int64_t minX = INT64_MAX, minY = INT64_MAX, maxX = INT64_MIN, maxY = INT64_MIN;
+        m_population = 0;
+        for (SparseTile const* tile : m_tileList)
+        {
+            word_t const* rows = tile->rows[m_parity];
+            word_t columns = 0;
+            int64_t firstRow = -1, lastRow = -1;
+            for (size_t y = 0; y < SparseTile::side; y++)
+            {
+                if (rows[y] == 0)
+                    continue;
+                columns |= rows[y];
+                m_population += std::bitset<bitsPerWord>(rows[y]).count();
+                if (firstRow < 0)
+                    firstRow = static_cast<int64_t>(y);
+                lastRow = static_cast<int64_t>(y);
+            }
+            if (columns == 0)
+                continue;
+
+            int64_t firstColumn = 0, lastColumn = side - 1;
+            while (((columns >> firstColumn) & 1) == 0)
+                firstColumn++;
+            while (((columns >> lastColumn) & 1) == 0)
+                lastColumn--;
+            minX = std::min(minX, tile->x * side + firstColumn);
+            maxX = std::max(maxX, tile->x * side + lastColumn);
+            minY = std::min(minY, tile->y * side + firstRow);
+            maxY = std::max(maxY, tile->y * side + lastRow);
+        }
+
+        m_bounds = minX > maxX ? WorldRect{ 0, 0, 0, 0 }
+                               : WorldRect{ minX, minY, static_cast<uint64_t>(maxX - minX) + 1, static_cast<uint64_t>(maxY - minY) + 1 };
+        m_boundsChanged = false;
+        return m_bounds;
+    }
+
+    inline uint64_t SparseEngine::getPopulation() const
+    {
+        getBoundingBox();
+        return m_population;
+    }
+
+
+
+    // --------------------- SPARSE VIEW -----------------------//
+    class SparseView : public IView
+    {
+    public:
+        using EngineType = SparseEngine;
+
+        SparseView(EngineType& engine)
+            : m_engine(engine) {}
+
+        void computeColors(Viewport const& viewport, uint8_t* pixels) const override
+        {
+            colorViewport(viewport, pixels, [this](size_t y, size_t xBegin, size_t xEnd) { return countAlive(y, xBegin, xEnd); });
+        }
+        void updateColors(Viewport const& viewport, ChangeSet const& changes, uint8_t* pixels) const override
+        {
+            colorChangedPixels(viewport, changes, pixels, [this](size_t y, size_t xBegin, size_t xEnd) { return countAlive(y, xBegin, xEnd); });
+        }
+
+    private:
+        EngineType& m_engine;
+
+        // The viewport is within the frame, whose cells are offset by the origin
+        inline size_t countAlive(size_t y, size_t xBegin, size_t xEnd) const
+        {
+            const CellCoordinates origin = m_engine.getOrigin();
+            return m_engine.countAlive(origin.y + static_cast<int64_t>(y),
+                                       origin.x + static_cast<int64_t>(xBegin), origin.x + static_cast<int64_t>(xEnd));
+        }
+    };
+}
\ No newline at end of file
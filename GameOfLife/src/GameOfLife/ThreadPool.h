@@ -0,0 +1,182 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace GameOfLife
+{
+    // Persistent pool of worker threads, the calling thread taking part in the work too.
+    // The workers sleep between two parallelFor() calls instead of being respawned.
+    class ThreadPool final
+    {
+    public:
+        using task_t = std::function<void(size_t)>;
+
+        // One thread per physical core unless set otherwise : the hardware threads of a core share its execution units,
+        // and several processes running side by side would oversubscribe the cores with one thread per hardware thread each
+        static inline size_t defaultThreadCount()
+        {
+            const size_t nbThreads = threadCountSetting().load(std::memory_order_relaxed);
+            return nbThreads > 0 ? nbThreads : physicalCoreCount();
+        }
+
+        // 0 goes back to one thread per physical core
+        static inline void setDefaultThreadCount(size_t nbThreads)
+        {
+            threadCountSetting().store(nbThreads, std::memory_order_relaxed);
+        }
+
+        static size_t physicalCoreCount();
+
+        ThreadPool(size_t nbThreads = defaultThreadCount())
+            : m_task(nullptr), m_nbTasks(0), m_nextTask(0),
+              m_nbBusyWorkers(0), m_generation(0), m_stopping(false)
+        {
+            for (size_t i = 1; i < nbThreads; i++)
+                m_workers.emplace_back([this] { workerLoop(); });
+        }
+
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stopping = true;
+            }
+            m_wakeUp.notify_all();
+            for (std::thread& worker : m_workers)
+                worker.join();
+        }
+
+        ThreadPool(ThreadPool const&) = delete;
+        ThreadPool& operator=(ThreadPool const&) = delete;
+
+        // Number of threads running the tasks, calling thread included
+        inline size_t size() const { return m_workers.size() + 1; }
+
+        // Runs task(i) for every i in [0, nbTasks), returns once all of them are done
+        void parallelFor(size_t nbTasks, task_t const& task);
+
+    private:
+        static inline std::atomic<size_t>& threadCountSetting()
+        {
+            static std::atomic<size_t> nbThreads(0);
+            return nbThreads;
+        }
+
+        std::vector<std::thread> m_workers;
+        std::mutex               m_mutex;
+        std::condition_variable  m_wakeUp;
+        std::condition_variable  m_allDone;
+
+        task_t const*            m_task;
+        size_t                   m_nbTasks;
+        std::atomic<size_t>      m_nextTask;
+        size_t                   m_nbBusyWorkers;
+        uint64_t                 m_generation;
+        bool                     m_stopping;
+
+        inline void runTasks(task_t const& task, size_t nbTasks)
+        {
+            for (size_t i = m_nextTask++; i < nbTasks; i = m_nextTask++)
+                task(i);
+        }
+
+        void workerLoop();
+    };
+
+    inline void ThreadPool::parallelFor(size_t nbTasks, task_t const& task)
+    {
+        if (m_workers.empty() || nbTasks <= 1)
+        {
+            for (size_t i = 0; i < nbTasks; i++)
+                task(i);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_task          = &task;
+            m_nbTasks       = nbTasks;
+            m_nextTask      = 0;
+            m_nbBusyWorkers = m_workers.size();
+            m_generation++;
+        }
+        m_wakeUp.notify_all();
+
+        runTasks(task, nbTasks);
+
+        // Barrier : every worker has to be done before the caller can use the results
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_allDone.wait(lock, [this] { return m_nbBusyWorkers == 0; });
+        m_task = nullptr;
+    }
+
+    // Counts the distinct (package, core) pairs of /proc/cpuinfo, the hardware threads of a core sharing the pair.
+    // Falls back on the hardware threads elsewhere or when the cores aren't listed.
+    inline size_t ThreadPool::physicalCoreCount()
+    {
+        static const size_t nbCores = []
+        {
+            const size_t hardwareThreads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+#ifdef __linux__
+            std::ifstream cpuInfo("/proc/cpuinfo");
+            std::set<std::pair<std::string, std::string>> cores;
+            std::string line, package;
+            while (std::getline(cpuInfo, line))
+            {
+                const size_t colon = line.find(':');
+                if (colon == std::string::npos)
+                    continue;
+                const std::string value = colon + 2 <= line.size() ? line.substr(colon + 2) : std::string();
+                if (line.compare(0, 11, "physical id") == 0)
+                    package = value;
+                else if (line.compare(0, 7, "core id") == 0)
+                    cores.emplace(package, value);
+            }
+            if (!cores.empty())
+                return std::min(cores.size(), hardwareThreads);
+#endif
+            return hardwareThreads;
+        }();
+        return nbCores;
+    }
+
+    inline void ThreadPool::workerLoop()
+    {
+        uint64_t lastGeneration = 0;
+        while (true)
+        {
+            task_t const* task;
+            size_t nbTasks;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wakeUp.wait(lock, [&] { return m_stopping || m_generation != lastGeneration; });
+                if (m_stopping)
+                    return;
+                lastGeneration = m_generation;
+                task    = m_task;
+                nbTasks = m_nbTasks;
+            }
+
+            runTasks(*task, nbTasks);
+
+            bool lastOne;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                lastOne = --m_nbBusyWorkers == 0;
+            }
+            if (lastOne)
+                m_allDone.notify_one();
+        }
+    }
+}
\ No newline at end of file
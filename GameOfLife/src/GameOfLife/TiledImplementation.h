@@ -0,0 +1,168 @@
+#pragma once
+
+#include <cstring>
+#include <vector>
+
+#include "SIMDImplementation.h"
+
+namespace GameOfLife
+{
+    // ------------------- TILED CPU ENGINE --------------------//
+    // Splits the grid into tiles and only computes the tiles that changed during the last generation,
+    // along with their neighbors. A tile that is skipped did not change, so both buffers already
+    // hold its state and it does not have to be copied.
+    template<size_t sideLength, size_t tileSize = 64>
+    class TiledCPUEngine : public CPUEngine<sideLength>
+    {
+    public:
+        static constexpr size_t tilesPerRow = (sideLength + tileSize - 1) / tileSize;
+        static constexpr size_t tileCount   = tilesPerRow * tilesPerRow;
+
+        TiledCPUEngine()
+            : CPUEngine<sideLength>(), m_rowKernel(selectRowKernel()),
+              m_changedTiles(tileCount, true), m_nextChangedTiles(tileCount, false), m_activeTileCount(0) {}
+        TiledCPUEngine(cell_states_t<sideLength>&& initial_states)
+            : CPUEngine<sideLength>(std::move(initial_states)), m_rowKernel(selectRowKernel()),
+              m_changedTiles(tileCount, true), m_nextChangedTiles(tileCount, false), m_activeTileCount(0) {}
+
+        // Number of tiles computed during the last generation, out of getTileCount()
+        inline size_t getActiveTileCount() const { return m_activeTileCount; }
+        inline size_t getTileCount() const       { return tileCount; }
+
+        void setCellState(size_t x, size_t y, bool isAlive) override
+        {
+            this->m_cellStates[x + y * sideLength] = isAlive;
+            m_changedTiles[x / tileSize + (y / tileSize) * tilesPerRow] = true;
+            this->m_changes.markCell(x, y);
+        }
+        void clearCells() override
+        {
+            this->m_cellStates.fill(false);
+            this->m_nextCellStates.fill(false);
+            // Empty tiles only stay empty when no cell is born without neighbors
+            std::fill(m_changedTiles.begin(), m_changedTiles.end(), this->m_rule.hasBirthWithoutNeighbors());
+            this->m_changes.markAll();
+        }
+        void setRowCells(size_t x, size_t y, uint64_t const* words, size_t nbCells) override
+        {
+            CPUEngine<sideLength>::setRowCells(x, y, words, nbCells);
+            if (nbCells > 0)
+                std::fill(m_changedTiles.begin() + x / tileSize + (y / tileSize) * tilesPerRow,
+                          m_changedTiles.begin() + (x + nbCells - 1) / tileSize + (y / tileSize) * tilesPerRow + 1, true);
+        }
+        void computeNextGeneration() override;
+
+        bool setRule(Rule const& rule) override
+        {
+            // The skipped tiles hold their next state for the previous rule only
+            std::fill(m_changedTiles.begin(), m_changedTiles.end(), true);
+            return CPUEngine<sideLength>::setRule(rule);
+        }
+
+    private:
+        RowKernel         m_rowKernel;
+        std::vector<bool> m_changedTiles;
+        std::vector<bool> m_nextChangedTiles;
+        size_t            m_activeTileCount;
+
+        bool isTileActive(size_t tileX, size_t tileY) const;
+        template<typename RuleT>
+        bool computeTile(size_t tileX, size_t tileY, RuleT const& rule);
+        template<typename RuleT>
+        void computeTiles(RuleT const& rule);
+    };
+
+    template<size_t sideLength, size_t tileSize>
+    bool TiledCPUEngine<sideLength, tileSize>::isTileActive(size_t tileX, size_t tileY) const
+    {
+        // The tile grid wraps around like the cell grid
+        for (size_t dy = 0; dy < 3; dy++)
+        {
+            const size_t neighborY = (tileY + tilesPerRow + dy - 1) % tilesPerRow;
+            for (size_t dx = 0; dx < 3; dx++)
+            {
+                const size_t neighborX = (tileX + tilesPerRow + dx - 1) % tilesPerRow;
+                if (m_changedTiles[neighborX + neighborY * tilesPerRow])
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    template<size_t sideLength, size_t tileSize>
+    template<typename RuleT>
+    bool TiledCPUEngine<sideLength, tileSize>::computeTile(size_t tileX, size_t tileY, RuleT const& rule)
+    {
+        uint8_t const* cells = reinterpret_cast<uint8_t const*>(this->m_cellStates.get());
+        uint8_t*       next  = reinterpret_cast<uint8_t*>(this->m_nextCellStates.get());
+
+        const size_t firstX = tileX * tileSize;
+        const size_t lastX  = std::min(firstX + tileSize, sideLength);
+        const size_t firstY = tileY * tileSize;
+        const size_t lastY  = std::min(firstY + tileSize, sideLength);
+
+        // The first and last columns of the grid wrap around, the ones in between go through the row kernel
+        const size_t kernelBegin = std::max<size_t>(firstX, 1);
+        const size_t kernelEnd   = std::min(lastX, sideLength - 1);
+
+        bool changed = false;
+        for (size_t y = firstY; y < lastY; y++)
+        {
+            const size_t topY = y == 0 ? sideLength - 1 : y - 1;
+            const size_t botY = y == sideLength - 1 ? 0 : y + 1;
+
+            uint8_t const* top = cells + topY * sideLength;
+            uint8_t const* mid = cells + y    * sideLength;
+            uint8_t const* bot = cells + botY * sideLength;
+            uint8_t*       out = next  + y    * sideLength;
+
+            if (kernelBegin < kernelEnd)
+                runRowKernel(m_rowKernel, top, mid, bot, out, kernelBegin, kernelEnd, rule);
+            if (firstX == 0)
+                out[0] = nextCellState(top, mid, bot, sideLength - 1, 0, sideLength > 1 ? 1 : 0, rule);
+            if (lastX == sideLength && sideLength > 1)
+                out[sideLength - 1] = nextCellState(top, mid, bot, sideLength - 2, sideLength - 1, 0, rule);
+
+            changed = changed || std::memcmp(out + firstX, mid + firstX, lastX - firstX) != 0;
+        }
+        return changed;
+    }
+
+    template<size_t sideLength, size_t tileSize>
+    void TiledCPUEngine<sideLength, tileSize>::computeNextGeneration()
+    {
+        dispatchRule(this->m_rule, [this](auto const& rule) { computeTiles(rule); });
+
+        // Makes the new generation the current generation
+        std::swap(this->m_cellStates, this->m_nextCellStates);
+        std::swap(m_changedTiles, m_nextChangedTiles);
+    }
+
+    template<size_t sideLength, size_t tileSize>
+    template<typename RuleT>
+    void TiledCPUEngine<sideLength, tileSize>::computeTiles(RuleT const& rule)
+    {
+        // Builds the next states of the active tiles on m_nextCellStates
+        m_activeTileCount = 0;
+        for (size_t tileY = 0; tileY < tilesPerRow; tileY++)
+        {
+            for (size_t tileX = 0; tileX < tilesPerRow; tileX++)
+            {
+                bool changed = false;
+                if (isTileActive(tileX, tileY))
+                {
+                    changed = computeTile(tileX, tileY, rule);
+                    m_activeTileCount++;
+                }
+                if (changed && this->m_trackChanges)
+                {
+                    const size_t firstX = tileX * tileSize;
+                    const size_t firstY = tileY * tileSize;
+                    this->m_changes.markRect(Rect{ firstX, firstY, std::min(tileSize, sideLength - firstX),
+                                                                   std::min(tileSize, sideLength - firstY) });
+                }
+                m_nextChangedTiles[tileX + tileY * tilesPerRow] = changed;
+            }
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,216 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifndef _WIN32
+    #include <cerrno>
+    #include <sys/socket.h>
+    #include <unistd.h>
+#endif
+
+namespace GameOfLife
+{
+    // Carries messages between the processes of a distributed run, numbered from 0 to getSize() - 1.
+    // The messages sent to a process arrive in the order they were sent.
+    class ITransport
+    {
+    public:
+        virtual ~ITransport() {}
+
+        virtual size_t getRank() const = 0;
+        virtual size_t getSize() const = 0;
+
+        // Returns at once, the message being sent in the background
+        virtual void send(size_t rank, std::vector<uint64_t>&& message) = 0;
+
+        // Waits for the next message of the process, returning false if the transport failed
+        virtual bool receive(size_t rank, std::vector<uint64_t>& message) = 0;
+
+        virtual std::string getError() const = 0;
+    };
+
+#ifndef _WIN32
+    // ------------------- SOCKET TRANSPORT --------------------//
+    // Connected stream sockets, one per other process : a message is its number of words followed by its words.
+    // A thread writes the queued messages, so that sending never waits for the other processes to read.
+    class SocketTransport final : public ITransport
+    {
+    public:
+        // sockets[rank] is connected to the process rank, the one of this process being unused
+        SocketTransport(size_t rank, std::vector<int> const& sockets)
+            : m_rank(rank), m_sockets(sockets), m_stopping(false)
+        {
+            m_thread = std::thread([this] { sendLoop(); });
+        }
+
+        // The queued messages are sent before returning
+        ~SocketTransport()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stopping = true;
+            }
+            m_wakeUp.notify_one();
+            m_thread.join();
+            for (size_t rank = 0; rank < m_sockets.size(); rank++)
+                if (rank != m_rank)
+                    ::close(m_sockets[rank]);
+        }
+
+        SocketTransport(SocketTransport const&) = delete;
+        SocketTransport& operator=(SocketTransport const&) = delete;
+
+        size_t getRank() const override { return m_rank; }
+        size_t getSize() const override { return m_sockets.size(); }
+
+        void send(size_t rank, std::vector<uint64_t>&& message) override
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_queue.emplace_back(rank, std::move(message));
+            }
+            m_wakeUp.notify_one();
+        }
+
+        bool receive(size_t rank, std::vector<uint64_t>& message) override
+        {
+            uint64_t nbWords = 0;
+            if (!readAll(m_sockets[rank], &nbWords, sizeof(nbWords)))
+                return fail("cannot receive from process " + std::to_string(rank));
+            message.resize(nbWords);
+            if (!readAll(m_sockets[rank], message.data(), nbWords * sizeof(uint64_t)))
+                return fail("cannot receive from process " + std::to_string(rank));
+            return true;
+        }
+
+        std::string getError() const override
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_error;
+        }
+
+        // Connects every pair of nbProcesses processes on this machine, sockets[a][b] being the end of a connected to b.
+        // Meant to be called before forking the processes, each one then keeping its sockets and closing the others.
+        static bool createMesh(size_t nbProcesses, std::vector<std::vector<int>>& sockets, std::string& error);
+        static void closeMesh(std::vector<std::vector<int>> const& sockets, size_t exceptRank);
+
+    private:
+        size_t                   m_rank;
+        std::vector<int>         m_sockets;
+
+        std::thread              m_thread;
+        mutable std::mutex       m_mutex;
+        std::condition_variable  m_wakeUp;
+        std::deque<std::pair<size_t, std::vector<uint64_t>>> m_queue;
+        bool                     m_stopping;
+        std::string              m_error;
+
+        bool fail(std::string const& error)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_error.empty())
+                m_error = error;
+            return false;
+        }
+
+        static bool readAll(int socket, void* data, size_t size);
+        static bool writeAll(int socket, void const* data, size_t size);
+        void sendLoop();
+    };
+
+    inline bool SocketTransport::readAll(int socket, void* data, size_t size)
+    {
+        uint8_t* bytes = static_cast<uint8_t*>(data);
+        while (size > 0)
+        {
+            const ssize_t nbRead = ::read(socket, bytes, size);
+            if (nbRead < 0 && errno == EINTR)
+                continue;
+            if (nbRead <= 0)
+                return false;
+            bytes += nbRead;
+            size  -= static_cast<size_t>(nbRead);
+        }
+        return true;
+    }
+
+    inline bool SocketTransport::writeAll(int socket, void const* data, size_t size)
+    {
+        uint8_t const* bytes = static_cast<uint8_t const*>(data);
+        while (size > 0)
+        {
+            // A process that exited makes the write fail instead of raising SIGPIPE
+#ifdef MSG_NOSIGNAL
+            const ssize_t nbWritten = ::send(socket, bytes, size, MSG_NOSIGNAL);
+#else
+            const ssize_t nbWritten = ::send(socket, bytes, size, 0);
+#endif
+            if (nbWritten < 0 && errno == EINTR)
+                continue;
+            if (nbWritten <= 0)
+                return false;
+            bytes += nbWritten;
+            size  -= static_cast<size_t>(nbWritten);
+        }
+        return true;
+    }
+
+    inline void SocketTransport::sendLoop()
+    {
+        for (;;)
+        {
+            std::pair<size_t, std::vector<uint64_t>> message;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wakeUp.wait(lock, [this] { return !m_queue.empty() || m_stopping; });
+                if (m_queue.empty())
+                    return;
+                message = std::move(m_queue.front());
+                m_queue.pop_front();
+            }
+
+            const uint64_t nbWords = message.second.size();
+            const int socket = m_sockets[message.first];
+            if (!writeAll(socket, &nbWords, sizeof(nbWords))
+             || !writeAll(socket, message.second.data(), nbWords * sizeof(uint64_t)))
+                fail("cannot send to process " + std::to_string(message.first));
+        }
+    }
+
+    inline bool SocketTransport::createMesh(size_t nbProcesses, std::vector<std::vector<int>>& sockets, std::string& error)
+    {
+        sockets.assign(nbProcesses, std::vector<int>(nbProcesses, -1));
+        for (size_t a = 0; a < nbProcesses; a++)
+            for (size_t b = a + 1; b < nbProcesses; b++)
+            {
+                int pair[2];
+                if (::socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0)
+                {
+                    error = std::string("cannot create sockets : ") + std::strerror(errno);
+                    closeMesh(sockets, nbProcesses);
+                    return false;
+                }
+                sockets[a][b] = pair[0];
+                sockets[b][a] = pair[1];
+            }
+        return true;
+    }
+
+    inline void SocketTransport::closeMesh(std::vector<std::vector<int>> const& sockets, size_t exceptRank)
+    {
+        for (size_t a = 0; a < sockets.size(); a++)
+            if (a != exceptRank)
+                for (int socket : sockets[a])
+                    if (socket >= 0)
+                        ::close(socket);
+    }
+#endif
+}
\ No newline at end of file
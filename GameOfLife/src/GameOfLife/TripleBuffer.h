@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace GameOfLife
+{
+    // Lock-free single producer / single consumer triple buffer.
+    // The producer fills back() and publishes it, the consumer takes the latest published slot with update().
+    // Neither side ever waits for the other : a slot that was not taken in time is simply overwritten.
+    template<typename T>
+    class TripleBuffer final
+    {
+    public:
+        static constexpr size_t slotCount = 3;
+
+        TripleBuffer(T const& initial)
+            : m_slots{ initial, initial, initial }, m_middle(1), m_back(2), m_front(0) {}
+
+        TripleBuffer(TripleBuffer const&) = delete;
+        TripleBuffer& operator=(TripleBuffer const&) = delete;
+
+        // Producer side
+        inline T& back() { return m_slots[m_back]; }
+        // Index of back() among the slotCount slots, for producers keeping state of their own per slot
+        inline size_t backIndex() const { return m_back; }
+        inline void publish()
+        {
+            m_back = m_middle.exchange(m_back | freshBit, std::memory_order_acq_rel) & indexMask;
+        }
+
+        // True while the last published slot has not been taken by the consumer
+        inline bool hasFresh() const { return (m_middle.load(std::memory_order_acquire) & freshBit) != 0; }
+
+        // Consumer side : returns true if front() changed
+        inline bool update()
+        {
+            if (!hasFresh())
+                return false;
+            m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & indexMask;
+            return true;
+        }
+        inline T const& front() const { return m_slots[m_front]; }
+
+    private:
+        static constexpr uint8_t freshBit  = 0x4;
+        static constexpr uint8_t indexMask = 0x3;
+
+        T                    m_slots[slotCount];
+        std::atomic<uint8_t> m_middle;
+        uint8_t              m_back;
+        uint8_t              m_front;
+    };
+}
\ No newline at end of file
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace GameOfLife
+{
+    // How the cells covered by one pixel are reduced to its color when zoomed out
+    enum class Pooling : uint8_t
+    {
+        Max,        // Lit as soon as one of the cells is alive
+        Density     // Brightness proportional to the ratio of alive cells
+    };
+
+    struct Rect
+    {
+        size_t x;
+        size_t y;
+        size_t width;
+        size_t height;
+    };
+
+    // Cell of an unbounded plane, in world coordinates
+    struct CellCoordinates
+    {
+        int64_t x;
+        int64_t y;
+
+        inline bool operator==(CellCoordinates const& other) const { return x == other.x && y == other.y; }
+        inline bool operator!=(CellCoordinates const& other) const { return !(*this == other); }
+    };
+
+    // Region of the grid to color, each pixel standing for a square of scale x scale cells
+    struct Viewport
+    {
+        size_t  x      = 0;
+        size_t  y      = 0;
+        size_t  width  = 0;
+        size_t  height = 0;
+        size_t  scale  = 1;
+        Pooling pooling = Pooling::Max;
+
+        inline size_t getPixelWidth() const  { return (width  + scale - 1) / scale; }
+        inline size_t getPixelHeight() const { return (height + scale - 1) / scale; }
+
+        // Pixels covering the given cells, false if none of them is within the viewport
+        inline bool getPixelRect(Rect const& cells, Rect& pixels) const
+        {
+            const size_t beginX = std::max(cells.x, x);
+            const size_t beginY = std::max(cells.y, y);
+            const size_t endX   = std::min(cells.x + cells.width,  x + width);
+            const size_t endY   = std::min(cells.y + cells.height, y + height);
+            if (beginX >= endX || beginY >= endY)
+                return false;
+
+            pixels.x      = (beginX - x) / scale;
+            pixels.y      = (beginY - y) / scale;
+            pixels.width  = (endX - x + scale - 1) / scale - pixels.x;
+            pixels.height = (endY - y + scale - 1) / scale - pixels.y;
+            return true;
+        }
+
+        inline bool operator==(Viewport const& other) const
+        {
+            return x == other.x && y == other.y && width == other.width && height == other.height
+                && scale == other.scale && pooling == other.pooling;
+        }
+        inline bool operator!=(Viewport const& other) const { return !(*this == other); }
+    };
+
+    // Writes the RGBA colors of the pixels of pixelRect to pixels, which holds the whole viewport
+    // with getPixelWidth() pixels per row.
+    // countAlive(y, xBegin, xEnd) returns the number of alive cells of the row y in [xBegin, xEnd).
+    template<typename CountAlive>
+    void colorPixels(Viewport const& viewport, Rect const& pixelRect, uint8_t* pixels, CountAlive&& countAlive)
+    {
+        const size_t endX = viewport.x + viewport.width;
+        const size_t endY = viewport.y + viewport.height;
+
+        for (size_t pixelY = pixelRect.y; pixelY < pixelRect.y + pixelRect.height; pixelY++)
+        {
+            const size_t firstY = viewport.y + pixelY * viewport.scale;
+            const size_t lastY  = std::min(firstY + viewport.scale, endY);
+
+            uint8_t* pixel = pixels + (pixelY * viewport.getPixelWidth() + pixelRect.x) * 4;
+            for (size_t pixelX = pixelRect.x; pixelX < pixelRect.x + pixelRect.width; pixelX++, pixel += 4)
+            {
+                const size_t firstX = viewport.x + pixelX * viewport.scale;
+                const size_t lastX  = std::min(firstX + viewport.scale, endX);
+
+                size_t nbAlive = 0;
+                for (size_t y = firstY; y < lastY; y++)
+                {
+                    nbAlive += countAlive(y, firstX, lastX);
+                    if (nbAlive > 0 && viewport.pooling == Pooling::Max)
+                        break;
+                }
+
+                uint8_t color;
+                if (viewport.pooling == Pooling::Max)
+                    color = nbAlive > 0 ? 200 : 0;
+                else
+                    color = static_cast<uint8_t>(nbAlive * 200 / ((lastY - firstY) * (lastX - firstX)));
+
+                pixel[0] = 10;
+                pixel[1] = color;
+                pixel[2] = color;
+                pixel[3] = 255;
+            }
+        }
+    }
+
+    // Writes the RGBA colors of the whole viewport to pixels, see colorPixels()
+    template<typename CountAlive>
+    void colorViewport(Viewport const& viewport, uint8_t* pixels, CountAlive&& countAlive)
+    {
+        colorPixels(viewport, Rect{ 0, 0, viewport.getPixelWidth(), viewport.getPixelHeight() }, pixels, countAlive);
+    }
+}
\ No newline at end of file
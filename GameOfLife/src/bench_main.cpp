@@ -0,0 +1,281 @@
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+
+#ifdef _WIN32
+    #include <windows.h>
+    #include <psapi.h>
+#else
+    #include <sys/resource.h>
+    #include <sys/wait.h>
+    #include <unistd.h>
+#endif
+
+#include "GameOfLife/BatchImplementation.h"
+#include "GameOfLife/CPUImplentation.h"
+#include "GameOfLife/SIMDImplementation.h"
+#include "GameOfLife/TiledImplementation.h"
+#include "GameOfLife/BitPackedImplementation.h"
+#include "GameOfLife/HashLifeImplementation.h"
+#include "GameOfLife/LookupTableImplementation.h"
+
+#include "main_constants.h"
+
+#define DEFAULT_GENERATIONS 100
+#define SEED                42
+#define BATCH_UNIVERSES     1024
+#define BATCH_SIDE_LENGTH   64
+
+static const double DENSITIES[] = { 0.1, 0.35, 0.5 };
+
+struct BenchOptions
+{
+    uint64_t    generations = DEFAULT_GENERATIONS;
+    const char* engineFilter = nullptr;
+};
+
+// Peak resident set size of the process so far, in bytes : the one of a configuration where it runs in its own process
+static size_t peakRSSBytes()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.PeakWorkingSetSize;
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+    #ifdef __APPLE__
+        return static_cast<size_t>(usage.ru_maxrss);
+    #else
+        return static_cast<size_t>(usage.ru_maxrss) * 1024;
+    #endif
+#endif
+}
+
+template<size_t sideLength>
+GameOfLife::cell_states_t<sideLength> randomCellStates(double density)
+{
+    std::mt19937_64 generator(SEED);
+    std::bernoulli_distribution isAlive(density);
+
+    GameOfLife::cell_states_t<sideLength> cell_states;
+    for (size_t i = 0; i < cell_states.size(); i++)
+        cell_states[i] = isAlive(generator);
+    return cell_states;
+}
+
+static void printResult(const char* engineName, size_t width, size_t height, double density,
+                        BenchOptions const& options, double seconds, bool& firstResult, size_t nbUniverses = 1)
+{
+    const double cellUpdates = static_cast<double>(options.generations) * width * height * nbUniverses;
+
+    std::printf("%s\n    {\"engine\": \"%s\", \"width\": %zu, \"height\": %zu, \"universes\": %zu, \"density\": %.2f, \"generations\": %llu, "
+                "\"seconds\": %.6f, \"generations_per_sec\": %.3f, \"cell_updates_per_sec\": %.1f, "
+                "\"ns_per_cell\": %.4f, \"peak_rss_bytes\": %zu}",
+                firstResult ? "" : ",", engineName, width, height, nbUniverses, density,
+                static_cast<unsigned long long>(options.generations), seconds,
+                options.generations / seconds, cellUpdates / seconds, seconds * 1e9 / cellUpdates,
+                peakRSSBytes());
+    std::fflush(stdout);
+    firstResult = false;
+}
+
+// Runs one configuration in a child process, whose peak memory only counts that configuration.
+// The child prints the result, the parent only learning whether it did. Without fork(), it runs in this process.
+template<typename Function>
+void runIsolated(Function const& run, bool& firstResult)
+{
+#ifdef _WIN32
+    run(firstResult);
+#else
+    // The output buffered so far would be printed by both processes
+    std::fflush(stdout);
+    const pid_t child = fork();
+    if (child < 0)
+    {
+        run(firstResult);
+        return;
+    }
+    if (child == 0)
+    {
+        bool isFirst = firstResult;
+        run(isFirst);
+        std::fflush(stdout);
+        _exit(EXIT_SUCCESS);
+    }
+
+    int status = 0;
+    if (waitpid(child, &status, 0) != child || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+    {
+        std::fprintf(stderr, "a benchmark process failed\n");
+        return;
+    }
+    firstResult = false;
+#endif
+}
+
+static double timeGenerations(GameOfLife::IEngine& engine, uint64_t generations)
+{
+    const auto start = std::chrono::steady_clock::now();
+    engine.advance(generations);
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+static bool isFilteredOut(const char* engineName, BenchOptions const& options)
+{
+    return options.engineFilter && std::strcmp(options.engineFilter, engineName) != 0;
+}
+
+template<size_t sideLength, typename EngineType>
+void runBenchmark(const char* engineName, BenchOptions const& options, bool& firstResult)
+{
+    if (isFilteredOut(engineName, options))
+        return;
+
+    for (double density : DENSITIES)
+        runIsolated([&](bool& isFirst)
+        {
+            EngineType engine(randomCellStates<sideLength>(density));
+            const double seconds = timeGenerations(engine, options.generations);
+            printResult(engineName, sideLength, sideLength, density, options, seconds, isFirst);
+        }, firstResult);
+}
+
+// Engines whose size is given to their constructor
+template<typename EngineType>
+void runRuntimeBenchmark(const char* engineName, size_t width, size_t height, BenchOptions const& options, bool& firstResult)
+{
+    if (isFilteredOut(engineName, options))
+        return;
+
+    for (double density : DENSITIES)
+        runIsolated([&](bool& isFirst)
+        {
+            std::mt19937_64 generator(SEED);
+            std::bernoulli_distribution isAlive(density);
+
+            EngineType engine(width, height);
+            for (size_t y = 0; y < height; y++)
+                for (size_t x = 0; x < width; x++)
+                    engine.setCellState(x, y, isAlive(generator));
+
+            const double seconds = timeGenerations(engine, options.generations);
+            printResult(engineName, width, height, density, options, seconds, isFirst);
+        }, firstResult);
+}
+
+// Many small soups, as a soup search runs them : a BatchEngine against one RuntimeBitPackedEngine per universe,
+// spread over as many threads. The batch stops the universes that settle, which is part of what it is measured for.
+static void runBatchBenchmark(size_t nbUniverses, size_t side, BenchOptions const& options, bool& firstResult)
+{
+    for (double density : DENSITIES)
+    {
+        if (!isFilteredOut("BatchEngine", options))
+            runIsolated([&](bool& isFirst)
+            {
+                GameOfLife::BatchEngine batch(nbUniverses, side, side);
+                for (size_t universe = 0; universe < nbUniverses; universe++)
+                    batch.randomize(universe, SEED + universe, density);
+
+                const auto start = std::chrono::steady_clock::now();
+                batch.advance(options.generations);
+                const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                printResult("BatchEngine", side, side, density, options, seconds, isFirst, nbUniverses);
+            }, firstResult);
+
+        if (!isFilteredOut("RuntimeBitPackedEngines", options))
+            runIsolated([&](bool& isFirst)
+            {
+                // The same soups, copied from a batch
+                GameOfLife::BatchEngine soups(nbUniverses, side, side, 1, 1);
+                std::vector<std::unique_ptr<GameOfLife::RuntimeBitPackedEngine>> engines;
+                for (size_t universe = 0; universe < nbUniverses; universe++)
+                {
+                    soups.randomize(universe, SEED + universe, density);
+                    engines.emplace_back(new GameOfLife::RuntimeBitPackedEngine(side, side));
+                    for (size_t y = 0; y < side; y++)
+                        for (size_t x = 0; x < side; x++)
+                            engines.back()->setCellState(x, y, soups.getCellState(universe, x, y));
+                }
+
+                GameOfLife::ThreadPool threadPool;
+                const size_t nbTasks = std::min(nbUniverses, threadPool.size() * 4);
+                const auto start = std::chrono::steady_clock::now();
+                threadPool.parallelFor(nbTasks, [&](size_t task)
+                {
+                    for (size_t universe = task * nbUniverses / nbTasks; universe < (task + 1) * nbUniverses / nbTasks; universe++)
+                        engines[universe]->advance(options.generations);
+                });
+                const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                printResult("RuntimeBitPackedEngines", side, side, density, options, seconds, isFirst, nbUniverses);
+            }, firstResult);
+    }
+}
+
+template<size_t sideLength>
+void benchmarkSideLength(BenchOptions const& options, bool& firstResult)
+{
+    runBenchmark<sideLength, GameOfLife::CPUEngine        <sideLength>>("CPUEngine",         options, firstResult);
+    runBenchmark<sideLength, GameOfLife::ParallelCPUEngine<sideLength>>("ParallelCPUEngine", options, firstResult);
+    runBenchmark<sideLength, GameOfLife::SIMDCPUEngine    <sideLength>>("SIMDCPUEngine",     options, firstResult);
+    runBenchmark<sideLength, GameOfLife::TiledCPUEngine   <sideLength>>("TiledCPUEngine",    options, firstResult);
+    runBenchmark<sideLength, GameOfLife::BitPackedEngine  <sideLength>>("BitPackedEngine",   options, firstResult);
+    if constexpr ((sideLength & (sideLength - 1)) == 0)
+        runBenchmark<sideLength, GameOfLife::HashLifeEngine<sideLength>>("HashLifeEngine", options, firstResult);
+    runRuntimeBenchmark<GameOfLife::RuntimeBitPackedEngine>("RuntimeBitPackedEngine", sideLength, sideLength, options, firstResult);
+    runRuntimeBenchmark<GameOfLife::LookupTableEngine>     ("LookupTableEngine",      sideLength, sideLength, options, firstResult);
+}
+
+static void printUsage(const char* program)
+{
+    std::fprintf(stderr, "usage: %s [--generations N] [--engine NAME]\n", program);
+}
+
+int main(int argc, char* argv[])
+{
+    BenchOptions options;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--generations") == 0 && i + 1 < argc)
+        {
+            // A number of generations of 0 would divide the timings by 0
+            char* end = nullptr;
+            const char* value = argv[++i];
+            options.generations = std::strtoull(value, &end, 10);
+            if (!std::isdigit(static_cast<unsigned char>(value[0])) || *end != '\0' || options.generations == 0)
+            {
+                printUsage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        }
+        else if (std::strcmp(argv[i], "--engine") == 0 && i + 1 < argc)
+            options.engineFilter = argv[++i];
+        else
+        {
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::printf("{\n  \"generations\": %llu,\n  \"results\": [",
+                static_cast<unsigned long long>(options.generations));
+
+    bool firstResult = true;
+    benchmarkSideLength<256>(options, firstResult);
+    benchmarkSideLength<1024>(options, firstResult);
+    benchmarkSideLength<SIDE_LENGTH>(options, firstResult);
+    runRuntimeBenchmark<GameOfLife::RuntimeBitPackedEngine>("RuntimeBitPackedEngine", 4 * SIDE_LENGTH, SIDE_LENGTH / 4, options, firstResult);
+    runRuntimeBenchmark<GameOfLife::LookupTableEngine>     ("LookupTableEngine",      4 * SIDE_LENGTH, SIDE_LENGTH / 4, options, firstResult);
+    runBatchBenchmark(BATCH_UNIVERSES, BATCH_SIDE_LENGTH, options, firstResult);
+
+    std::printf("\n  ]\n}\n");
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -1,27 +1,240 @@
+#include <cstdlib>
+#include <cstring>
+
 #include <SFML/Graphics/RenderWindow.hpp>
 #include <SFML/Graphics.hpp>
 
 #include "GameOfLife/Controller.h"
 #include "GameOfLife/CPUImplentation.h"
+#include "GameOfLife/BitPackedImplementation.h"
+#include "GameOfLife/Checkpoint.h"
+#include "GameOfLife/LookupTableImplementation.h"
+#include "GameOfLife/MultiStateImplementation.h"
+#include "GameOfLife/PatternLoader.h"
+#include "GameOfLife/SparseImplementation.h"
 
 #include "main_constants.h"
 
 #define TITLE "Game of Life (CPU)"
 
+// Cells to start from, the default ones being used when neither file is given
+struct StartFiles
+{
+    const char* patternFile    = nullptr;
+    const char* checkpointFile = nullptr;
+    const char* rule           = nullptr;   // Replaces the rule of the pattern
+
+    inline bool isEmpty() const { return !patternFile && !checkpointFile; }
+};
 
-int main()
+static void exitWithError(const char* fileName, std::string const& error)
 {
-    sf::RenderWindow window(sf::VideoMode(1000, 480), TITLE);
+    std::cerr << fileName << " : " << error << std::endl;
+    exit(EXIT_FAILURE);
+}
+
+// Loads the pattern or the checkpoint given on the command line, returning the generation to start from
+static uint64_t loadStartFiles(GameOfLife::IEngine& engine, StartFiles const& files)
+{
+    std::string error;
+    if (files.patternFile && !GameOfLife::loadPatternFile(files.patternFile, engine, error, !files.rule))
+        exitWithError(files.patternFile, error);
+
+    if (files.rule)
+    {
+        GameOfLife::Rule rule;
+        if (!GameOfLife::Rule::parse(files.rule, rule, error))
+            exitWithError(files.rule, error);
+        if (!engine.setRule(rule))
+            exitWithError(files.rule, "the engine can't run this rule");
+    }
+
+    if (files.checkpointFile)
+    {
+        GameOfLife::CheckpointReader checkpoint(files.checkpointFile);
+        if (!checkpoint.loadInto(engine, !files.rule))
+            exitWithError(files.checkpointFile, checkpoint.getError());
+        return checkpoint.getGeneration();
+    }
+    return 0;
+}
 
+// Default grid : SIDE_LENGTH is known at compile time
+static void runFixedSize(sf::RenderWindow& window, StartFiles const& files)
+{
     GameOfLife::cell_states_t<SIDE_LENGTH> cell_states;
     for (size_t i = 0; i < cell_states.size(); i++)
-        cell_states[i] = i > cell_states.size() * 2 / 5;
+        cell_states[i] = files.isEmpty() && i > cell_states.size() * 2 / 5;
+
+    GameOfLife::ParallelCPUEngine <SIDE_LENGTH> engine(std::move(cell_states));
+    const uint64_t firstGeneration = loadStartFiles(engine, files);
+
+    GameOfLife::CPUView           <SIDE_LENGTH> view(engine);
+    GameOfLife::Controller                      controller(engine, view, window, MOVE_AMOUNT_PER_SEC, ZOOM_FACTOR_PER_SCROLL_TICK, firstGeneration);
+
+    controller.mainLoop();
+}
+
+// Grid size given on the command line
+static void runRuntimeSize(sf::RenderWindow& window, size_t width, size_t height, StartFiles const& files)
+{
+    GameOfLife::RuntimeBitPackedEngine engine(width, height);
+    if (files.isEmpty())
+        for (size_t i = 0; i < width * height; i++)
+            engine.setCellState(i % width, i / width, i > width * height * 2 / 5);
+    const uint64_t firstGeneration = loadStartFiles(engine, files);
+
+    GameOfLife::RuntimeBitPackedView view(engine);
+    GameOfLife::Controller           controller(engine, view, window, MOVE_AMOUNT_PER_SEC, ZOOM_FACTOR_PER_SCROLL_TICK, firstGeneration);
+
+    controller.mainLoop();
+}
+
+// Grid of 2x2 blocks advanced by a lookup table, given by --engine lut
+static void runLookupTable(sf::RenderWindow& window, size_t width, size_t height, StartFiles const& files)
+{
+    GameOfLife::LookupTableEngine engine(width, height);
+    if (files.isEmpty())
+        for (size_t i = 0; i < width * height; i++)
+            engine.setCellState(i % width, i / width, i > width * height * 2 / 5);
+    const uint64_t firstGeneration = loadStartFiles(engine, files);
+
+    GameOfLife::LookupTableView view(engine);
+    GameOfLife::Controller      controller(engine, view, window, MOVE_AMOUNT_PER_SEC, ZOOM_FACTOR_PER_SCROLL_TICK, firstGeneration);
+
+    controller.mainLoop();
+}
+
+// Generations and Larger than Life rules, given by --rule
+static void runMultiState(sf::RenderWindow& window, size_t width, size_t height,
+                          GameOfLife::MultiStateRule const& rule, StartFiles files)
+{
+    // The pattern's cells past the alive state are kept by a rule with as many states
+    GameOfLife::MultiStateEngine engine(width, height, rule);
+    if (files.isEmpty())
+        for (size_t i = 0; i < width * height; i++)
+            engine.setCellState(i % width, i / width, i > width * height * 2 / 5);
+
+    // The rule of the pattern is replaced
+    files.rule = nullptr;
+    const uint64_t firstGeneration = loadStartFiles(engine, files);
+    engine.setMultiStateRule(rule);
+
+    GameOfLife::MultiStateView view(engine);
+    GameOfLife::Controller     controller(engine, view, window, MOVE_AMOUNT_PER_SEC, ZOOM_FACTOR_PER_SCROLL_TICK, firstGeneration);
+
+    controller.mainLoop();
+}
 
-    GameOfLife::CPUEngine  <SIDE_LENGTH> engine(std::move(cell_states));
-    GameOfLife::CPUView    <SIDE_LENGTH> view(engine);
-    GameOfLife::Controller <SIDE_LENGTH> controller(engine, view, window, MOVE_AMOUNT_PER_SEC, ZOOM_FACTOR_PER_SCROLL_TICK);
+// Unbounded plane, of which a frame of the given size is shown around the camera
+static void runUnbounded(sf::RenderWindow& window, size_t width, size_t height, StartFiles const& files)
+{
+    GameOfLife::SparseEngine engine(width, height);
+    if (files.isEmpty())
+        for (size_t i = 0; i < width * height; i++)
+            engine.setCellState(i % width, i / width, i > width * height * 2 / 5);
+    const uint64_t firstGeneration = loadStartFiles(engine, files);
+
+    GameOfLife::SparseView view(engine);
+    GameOfLife::Controller controller(engine, view, window, MOVE_AMOUNT_PER_SEC, ZOOM_FACTOR_PER_SCROLL_TICK, firstGeneration);
 
     controller.mainLoop();
+}
+
+int main(int argc, char* argv[])
+{
+    size_t width  = 0;
+    size_t height = 0;
+    bool   unbounded = false;
+    const char* engineName = nullptr;
+    StartFiles files;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--width") == 0 && i + 1 < argc)
+            width = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--height") == 0 && i + 1 < argc)
+            height = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--pattern") == 0 && i + 1 < argc)
+            files.patternFile = argv[++i];
+        else if (std::strcmp(argv[i], "--resume") == 0 && i + 1 < argc)
+            files.checkpointFile = argv[++i];
+        else if (std::strcmp(argv[i], "--rule") == 0 && i + 1 < argc)
+            files.rule = argv[++i];
+        else if (std::strcmp(argv[i], "--unbounded") == 0)
+            unbounded = true;
+        else if (std::strcmp(argv[i], "--engine") == 0 && i + 1 < argc)
+            engineName = argv[++i];
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            GameOfLife::ThreadPool::setDefaultThreadCount(std::strtoull(argv[++i], nullptr, 10));
+        else
+        {
+            std::cerr << "usage: " << argv[0] << " [--width W] [--height H] [--pattern FILE.rle|.cells|.mc] [--resume CHECKPOINT] [--rule B3/S23|B2/S/C3|R5,C0,M1,S34..58,B34..45,NM] [--unbounded] [--engine bitpacked|lut] [--threads N]" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    const bool lookupTable = engineName && std::strcmp(engineName, "lut") == 0;
+    if (engineName && !lookupTable && std::strcmp(engineName, "bitpacked") != 0)
+        exitWithError(engineName, "unknown engine, expected bitpacked or lut");
+
+    // Without a size, a run is resumed on a grid of the size of its checkpoint
+    if (files.checkpointFile && width == 0 && height == 0)
+    {
+        GameOfLife::CheckpointReader checkpoint(files.checkpointFile);
+        if (!checkpoint.isValid())
+            exitWithError(files.checkpointFile, checkpoint.getError());
+        if (checkpoint.getWidth() != SIDE_LENGTH || checkpoint.getHeight() != SIDE_LENGTH)
+        {
+            width  = checkpoint.getWidth();
+            height = checkpoint.getHeight();
+        }
+    }
+
+    // Rules with more states or a larger neighborhood run on their own engine, chosen by the rule given or else by the one of the pattern
+    std::string ruleText = files.rule ? files.rule : "";
+    std::string error;
+    if (!files.rule && files.patternFile)
+    {
+        GameOfLife::PatternInfo info;
+        if (!GameOfLife::readPatternInfo(files.patternFile, info, error))
+            exitWithError(files.patternFile, error);
+        ruleText = info.rule;
+    }
+
+    GameOfLife::Rule           rule;
+    GameOfLife::MultiStateRule multiStateRule;
+    const bool isTwoStates  = ruleText.empty() || GameOfLife::Rule::parse(ruleText, rule, error);
+    const bool isMultiState = !isTwoStates && GameOfLife::MultiStateRule::parse(ruleText, multiStateRule, error);
+    if (!isTwoStates && !isMultiState && files.rule)
+        exitWithError(files.rule, error);
+    if (!isTwoStates && !isMultiState)
+        std::cerr << files.patternFile << " : " << error << ", running the default rule" << std::endl;
+    if (isMultiState && unbounded)
+        exitWithError("--unbounded", "can't run the rule " + ruleText + ", which needs the multistate engine");
+    if (lookupTable && (isMultiState || unbounded))
+        exitWithError(engineName, isMultiState ? "can't run the rule " + ruleText + ", which needs the multistate engine"
+                                               : std::string("can't run on an unbounded plane"));
+    // The cells are grouped by 2x2 blocks
+    if (lookupTable && ((width != 0 ? width : SIDE_LENGTH) % 2 != 0 || (height != 0 ? height : SIDE_LENGTH) % 2 != 0))
+        exitWithError(engineName, "runs on grids of even width and height only");
+
+    sf::RenderWindow window(sf::VideoMode(1000, 480), TITLE);
+    window.setFramerateLimit(MAX_DISPLAY_FPS);
+
+    if (isMultiState)
+        runMultiState(window, width  != 0 ? width  : SIDE_LENGTH,
+                              height != 0 ? height : SIDE_LENGTH, multiStateRule, files);
+    else if (unbounded)
+        runUnbounded(window, width  != 0 ? width  : SIDE_LENGTH,
+                             height != 0 ? height : SIDE_LENGTH, files);
+    else if (lookupTable)
+        runLookupTable(window, width  != 0 ? width  : SIDE_LENGTH,
+                               height != 0 ? height : SIDE_LENGTH, files);
+    else if (width == 0 && height == 0)
+        runFixedSize(window, files);
+    else
+        runRuntimeSize(window, width  != 0 ? width  : SIDE_LENGTH,
+                               height != 0 ? height : SIDE_LENGTH, files);
 
     return 0;
 }
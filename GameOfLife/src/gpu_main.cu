@@ -1,25 +1,87 @@
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
 #include <SFML/Graphics/RenderWindow.hpp>
 #include <SFML/Graphics.hpp>
 
 #include "GameOfLife/Controller.h"
 #include "GameOfLife/GPUImplementation.cuh"
+#include "GameOfLife/PatternLoader.h"
 
 #include "main_constants.h"
 
 #define TITLE "Game of Life (GPU)"
 
 
-int main()
+// The GPU engine takes its cells at construction, the pattern is loaded on the center of the host states
+static bool loadPattern(GameOfLife::cell_states_t<SIDE_LENGTH>& cell_states, const char* patternFile, GameOfLife::Rule& rule)
 {
-    sf::RenderWindow window(sf::VideoMode(1000, 480), TITLE);
+    std::ifstream file(patternFile, std::ios::binary);
+    GameOfLife::PatternLoader loader(file, GameOfLife::PatternLoader::formatOf(patternFile));
+    if (!file || !loader.readHeader())
+        return false;
+
+    GameOfLife::PatternInfo const& info = loader.getInfo();
+    if (info.width > SIDE_LENGTH || info.height > SIDE_LENGTH)
+        return false;
+
+    std::string error;
+    if (!info.rule.empty())
+        GameOfLife::Rule::parse(info.rule, rule, error);
+
+    const size_t originX = (SIDE_LENGTH - info.width)  / 2;
+    const size_t originY = (SIDE_LENGTH - info.height) / 2;
+    return loader.readRows([&](size_t y, uint64_t const* words)
+    {
+        bool* row = cell_states.get() + originX + (originY + y) * SIDE_LENGTH;
+        for (size_t x = 0; x < info.width; x++)
+            row[x] = (words[x / 64] >> (x % 64)) & 1;
+    });
+}
+
+int main(int argc, char* argv[])
+{
+    const char* patternFile = nullptr;
+    const char* ruleText    = nullptr;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--pattern") == 0 && i + 1 < argc)
+            patternFile = argv[++i];
+        else if (std::strcmp(argv[i], "--rule") == 0 && i + 1 < argc)
+            ruleText = argv[++i];
+        else
+        {
+            std::cerr << "usage: " << argv[0] << " [--pattern FILE.rle|.cells|.mc] [--rule B3/S23]" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
 
     GameOfLife::cell_states_t<SIDE_LENGTH> cell_states;
     for (size_t i = 0; i < cell_states.size(); i++)
-        cell_states[i] = i > cell_states.size() * 2 / 5;
+        cell_states[i] = !patternFile && i > cell_states.size() * 2 / 5;
+
+    GameOfLife::Rule rule;
+    if (patternFile && !loadPattern(cell_states, patternFile, rule))
+    {
+        std::cerr << "cannot load " << patternFile << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::string error;
+    if (ruleText && !GameOfLife::Rule::parse(ruleText, rule, error))
+    {
+        std::cerr << error << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    sf::RenderWindow window(sf::VideoMode(1000, 480), TITLE);
+    window.setFramerateLimit(MAX_DISPLAY_FPS);
 
     GameOfLife::GPUEngine  <SIDE_LENGTH> engine(std::move(cell_states));
+    engine.setRule(rule);
     GameOfLife::GPUView    <SIDE_LENGTH> view(engine);
-    GameOfLife::Controller <SIDE_LENGTH> controller(engine, view, window, MOVE_AMOUNT_PER_SEC, ZOOM_FACTOR_PER_SCROLL_TICK);
+    GameOfLife::Controller               controller(engine, view, window, MOVE_AMOUNT_PER_SEC, ZOOM_FACTOR_PER_SCROLL_TICK);
 
     controller.mainLoop();
 
@@ -0,0 +1,487 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+    #include <sys/wait.h>
+    #include <unistd.h>
+#endif
+
+#include "GameOfLife/BatchImplementation.h"
+#include "GameOfLife/CPUImplentation.h"
+#include "GameOfLife/BitPackedImplementation.h"
+#include "GameOfLife/Checkpoint.h"
+#include "GameOfLife/DistributedImplementation.h"
+#include "GameOfLife/FrameWriter.h"
+#include "GameOfLife/LookupTableImplementation.h"
+#include "GameOfLife/MultiStateImplementation.h"
+#include "GameOfLife/PatternLoader.h"
+#include "GameOfLife/SparseImplementation.h"
+
+#include "main_constants.h"
+
+#define DEFAULT_GENERATIONS 1000
+#define DEFAULT_FRAME_INTERVAL 100
+#define DEFAULT_QUEUED_FRAMES 4
+#define DEFAULT_OUTPUT "frame_"
+#define DEFAULT_BATCH_SIDE_LENGTH 64
+#define DEFAULT_MAX_PERIOD 64
+#define DEFAULT_DENSITY 0.5
+#define DEFAULT_HALO_WIDTH 8
+
+// Runs a simulation without a window, sampling frames to files or to the standard output.
+// The messages go to the standard error, the standard output possibly carrying the frames.
+struct HeadlessOptions
+{
+    const char*             engine         = nullptr;   // bitpacked, or multistate when the rule needs it
+    size_t                  width          = 0;
+    size_t                  height         = 0;
+    const char*             patternFile    = nullptr;
+    const char*             checkpointFile = nullptr;
+    const char*             rule           = nullptr;   // Replaces the rule of the pattern
+    uint64_t                generations    = DEFAULT_GENERATIONS;
+    uint64_t                frameInterval  = DEFAULT_FRAME_INTERVAL;    // 0 for no frames
+    GameOfLife::FrameFormat format         = GameOfLife::FrameFormat::PGM;
+    std::string             output         = DEFAULT_OUTPUT;
+    size_t                  maxQueued      = DEFAULT_QUEUED_FRAMES;
+
+    // Batch of random soups, one per seed from firstSeed on, instead of a single grid
+    size_t                  nbUniverses    = 0;
+    uint64_t                firstSeed      = 0;
+    uint32_t                maxPeriod      = DEFAULT_MAX_PERIOD;
+    double                  density        = DEFAULT_DENSITY;
+
+    // Processes sharing the grid, one domain each, rank 0 gathering the frames
+    size_t                  columns        = 0;
+    size_t                  rows           = 0;
+    size_t                  haloWidth      = DEFAULT_HALO_WIDTH;
+    size_t                  nbThreads      = 0;     // Per process, 0 for the default
+
+    inline bool isEmpty() const { return !patternFile && !checkpointFile; }
+};
+
+static void exitWithError(const char* fileName, std::string const& error)
+{
+    std::cerr << fileName << " : " << error << std::endl;
+    exit(EXIT_FAILURE);
+}
+
+// Loads the pattern or the checkpoint given on the command line, returning the generation to start from
+static uint64_t loadStartFiles(GameOfLife::IEngine& engine, HeadlessOptions const& options, bool setsRule)
+{
+    std::string error;
+    if (options.isEmpty())
+        for (size_t i = 0; i < engine.getWidth() * engine.getHeight(); i++)
+            engine.setCellState(i % engine.getWidth(), i / engine.getWidth(), i > engine.getWidth() * engine.getHeight() * 2 / 5);
+
+    if (options.patternFile && !GameOfLife::loadPatternFile(options.patternFile, engine, error, !options.rule))
+        exitWithError(options.patternFile, error);
+
+    if (options.rule && setsRule)
+    {
+        GameOfLife::Rule rule;
+        if (!GameOfLife::Rule::parse(options.rule, rule, error))
+            exitWithError(options.rule, error);
+        if (!engine.setRule(rule))
+            exitWithError(options.rule, "the engine can't run this rule");
+    }
+
+    if (options.checkpointFile)
+    {
+        GameOfLife::CheckpointReader checkpoint(options.checkpointFile);
+        if (!checkpoint.loadInto(engine, !options.rule))
+            exitWithError(options.checkpointFile, checkpoint.getError());
+        return checkpoint.getGeneration();
+    }
+    return 0;
+}
+
+// Computes the generations, calling capture(generation) on every frameInterval-th one and the last one
+template<typename Capture>
+static void advanceAndCapture(GameOfLife::IEngine& engine, uint64_t firstGeneration, HeadlessOptions const& options, Capture&& capture)
+{
+    const uint64_t lastGeneration = firstGeneration + options.generations;
+    uint64_t generation = firstGeneration;
+    if (options.frameInterval != 0)
+        capture(generation);
+    while (generation < lastGeneration)
+    {
+        uint64_t generations = lastGeneration - generation;
+        if (options.frameInterval != 0)
+            generations = std::min(generations, options.frameInterval - generation % options.frameInterval);
+        engine.advance(generations);
+        generation += generations;
+
+        if (options.frameInterval != 0 && (generation % options.frameInterval == 0 || generation == lastGeneration))
+            capture(generation);
+    }
+}
+
+// Waits for the frames to be written and prints how long the run took
+static void finishRun(GameOfLife::FrameWriter& writer, std::chrono::steady_clock::time_point start,
+                      double simulationSeconds, HeadlessOptions const& options)
+{
+    std::string error;
+    if (!writer.finish(error))
+        exitWithError(options.output.c_str(), error);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::fprintf(stderr, "%llu generations in %.3f s (%.1f gen/s), %zu frames written in %.3f s\n",
+                 static_cast<unsigned long long>(options.generations), simulationSeconds,
+                 options.generations / std::max(simulationSeconds, 1e-9), writer.getWrittenCount(), seconds);
+}
+
+// Computes the generations, capturing the frames while the previous ones are written
+static void run(GameOfLife::IEngine& engine, uint64_t firstGeneration, HeadlessOptions const& options)
+{
+    GameOfLife::FrameWriter writer(options.format, options.output, options.maxQueued);
+
+    const auto start = std::chrono::steady_clock::now();
+    advanceAndCapture(engine, firstGeneration, options, [&](uint64_t generation) { writer.capture(engine, generation); });
+    const double simulationSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    finishRun(writer, start, simulationSeconds, options);
+}
+
+#ifndef _WIN32
+// Sends the domain of every process to rank 0, which copies them to the torus
+static bool gatherDomains(GameOfLife::DistributedEngine const& engine, GameOfLife::ITransport& transport, GameOfLife::IEngine* torus)
+{
+    if (transport.getRank() != 0)
+    {
+        const GameOfLife::Rect domain = engine.getDomain();
+        const size_t rowWords = (domain.width + 63) / 64;
+        std::vector<uint64_t> message(rowWords * domain.height);
+        for (size_t y = 0; y < domain.height; y++)
+            engine.getRowCells(0, y, message.data() + y * rowWords, domain.width);
+        transport.send(0, std::move(message));
+        return true;
+    }
+
+    std::vector<uint64_t> message;
+    for (size_t rank = 0; rank < transport.getSize(); rank++)
+    {
+        const GameOfLife::Rect domain = engine.getLayout().getDomain(rank);
+        const size_t rowWords = (domain.width + 63) / 64;
+        if (rank == 0)
+        {
+            message.resize(rowWords * domain.height);
+            for (size_t y = 0; y < domain.height; y++)
+                engine.getRowCells(0, y, message.data() + y * rowWords, domain.width);
+        }
+        else if (!transport.receive(rank, message) || message.size() != rowWords * domain.height)
+            return false;
+
+        for (size_t y = 0; y < domain.height; y++)
+            torus->setRowCells(domain.x, domain.y + y, message.data() + y * rowWords, domain.width);
+    }
+    return true;
+}
+
+// Forks a process per domain of the layout, connected by sockets. The whole torus is loaded before forking,
+// every process then copying its domain. Rank 0 gathers the domains on its torus to write the frames.
+static void runDistributed(size_t width, size_t height, HeadlessOptions const& options)
+{
+    const GameOfLife::DomainLayout layout{ width, height, options.columns, options.rows };
+    std::string error;
+    if (!layout.validate(std::max<size_t>(options.haloWidth, 1), error))
+        exitWithError("--processes", error);
+
+    std::unique_ptr<GameOfLife::RuntimeBitPackedEngine> torus(new GameOfLife::RuntimeBitPackedEngine(width, height));
+    const uint64_t firstGeneration = loadStartFiles(*torus, options, true);
+    const GameOfLife::Rule rule = torus->getRule();
+
+    // The processes share the cores
+    const size_t nbProcesses = layout.getProcessCount();
+    GameOfLife::ThreadPool::setDefaultThreadCount(options.nbThreads != 0 ? options.nbThreads
+                                                  : std::max<size_t>(GameOfLife::ThreadPool::physicalCoreCount() / nbProcesses, 1));
+
+    std::vector<std::vector<int>> sockets;
+    if (!GameOfLife::SocketTransport::createMesh(nbProcesses, sockets, error))
+        exitWithError("--processes", error);
+
+    // The output buffered so far would be written by every process
+    std::fflush(stdout);
+    std::fflush(stderr);
+    size_t rank = 0;
+    std::vector<pid_t> children;
+    for (size_t child = 1; child < nbProcesses && rank == 0; child++)
+    {
+        const pid_t pid = fork();
+        if (pid < 0)
+            exitWithError("--processes", std::string("cannot fork : ") + std::strerror(errno));
+        if (pid == 0)
+            rank = child;
+        else
+            children.push_back(pid);
+    }
+    GameOfLife::SocketTransport::closeMesh(sockets, rank);
+
+    {
+        GameOfLife::SocketTransport    transport(rank, sockets[rank]);
+        GameOfLife::DistributedEngine  engine(transport, layout, options.haloWidth);
+        engine.setRule(rule);
+
+        const GameOfLife::Rect domain = engine.getDomain();
+        std::vector<uint64_t> row((domain.width + 63) / 64);
+        for (size_t y = 0; y < domain.height; y++)
+        {
+            torus->getRowCells(domain.x, domain.y + y, row.data(), domain.width);
+            engine.setRowCells(0, y, row.data(), domain.width);
+        }
+        if (rank != 0)
+            torus.reset();
+
+        const std::string processName = "process " + std::to_string(rank);
+        std::unique_ptr<GameOfLife::FrameWriter> writer;
+        if (rank == 0)
+            writer.reset(new GameOfLife::FrameWriter(options.format, options.output, options.maxQueued));
+
+        const auto start = std::chrono::steady_clock::now();
+        advanceAndCapture(engine, firstGeneration, options, [&](uint64_t generation)
+        {
+            if (!gatherDomains(engine, transport, torus.get()))
+                exitWithError(processName.c_str(), "cannot gather the domains : " + transport.getError());
+            if (writer)
+                writer->capture(*torus, generation);
+        });
+        const double simulationSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (engine.hasFailed())
+            exitWithError(processName.c_str(), engine.getError());
+
+        if (rank == 0)
+            finishRun(*writer, start, simulationSeconds, options);
+    }
+
+    // The transport is closed once its messages are sent
+    if (rank != 0)
+        exit(EXIT_SUCCESS);
+
+    bool hasFailed = false;
+    for (pid_t child : children)
+    {
+        int status = 0;
+        hasFailed |= waitpid(child, &status, 0) != child || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS;
+    }
+    if (hasFailed)
+        exitWithError("--processes", "a process failed");
+}
+#endif
+
+// Runs a soup per seed until it settles or the generations are done, then prints one line per soup :
+// its seed, its population, the generations computed and, once settled, the generation its cycle started at and its period
+static void runBatch(size_t width, size_t height, HeadlessOptions const& options)
+{
+    GameOfLife::Rule rule;
+    std::string      error;
+    if (options.rule && !GameOfLife::Rule::parse(options.rule, rule, error))
+        exitWithError(options.rule, error);
+
+    GameOfLife::BatchEngine batch(options.nbUniverses, width, height, options.maxPeriod);
+    batch.setRule(rule);
+    for (size_t universe = 0; universe < options.nbUniverses; universe++)
+        batch.randomize(universe, options.firstSeed + universe, options.density);
+
+    const auto start = std::chrono::steady_clock::now();
+    batch.advance(options.generations);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t nbSettled = 0;
+    std::printf("seed population generations settled stabilization period\n");
+    for (size_t universe = 0; universe < options.nbUniverses; universe++)
+    {
+        const GameOfLife::UniverseResult result = batch.getResult(universe);
+        nbSettled += result.isSettled ? 1 : 0;
+        std::printf("%llu %llu %llu %d %llu %u\n", static_cast<unsigned long long>(options.firstSeed + universe),
+                    static_cast<unsigned long long>(result.population), static_cast<unsigned long long>(result.generation),
+                    result.isSettled ? 1 : 0, static_cast<unsigned long long>(result.stabilizationGeneration), result.period);
+    }
+    std::fprintf(stderr, "%zu soups of %zu x %zu cells in %.3f s, %zu settled\n",
+                 options.nbUniverses, width, height, seconds, nbSettled);
+}
+
+static bool parseFormat(const char* name, GameOfLife::FrameFormat& format)
+{
+    if (std::strcmp(name, "pgm") == 0)
+        format = GameOfLife::FrameFormat::PGM;
+    else if (std::strcmp(name, "png") == 0)
+        format = GameOfLife::FrameFormat::PNG;
+    else if (std::strcmp(name, "raw") == 0)
+        format = GameOfLife::FrameFormat::Raw;
+    else
+        return false;
+    return true;
+}
+
+static void printUsage(const char* program)
+{
+    std::fprintf(stderr, "usage: %s [--engine bitpacked|cpu|lut|multistate|sparse] [--width W] [--height H]\n"
+                         "       [--pattern FILE.rle|.cells|.mc] [--resume CHECKPOINT] [--rule B3/S23|B2/S/C3|R5,C0,M1,S34..58,B34..45,NM]\n"
+                         "       [--generations N] [--every K] [--format pgm|png|raw] [--output PREFIX|-] [--queue N] [--threads N]\n"
+                         "       [--processes COLUMNSxROWS [--halo K]]\n"
+                         "   or: %s --batch N [--width W] [--height H] [--seed FIRST] [--density D] [--max-period P]\n"
+                         "       [--rule B3/S23] [--generations N] [--threads N]\n", program, program);
+}
+
+int main(int argc, char* argv[])
+{
+    HeadlessOptions options;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--engine") == 0 && i + 1 < argc)
+            options.engine = argv[++i];
+        else if (std::strcmp(argv[i], "--width") == 0 && i + 1 < argc)
+            options.width = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--height") == 0 && i + 1 < argc)
+            options.height = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--pattern") == 0 && i + 1 < argc)
+            options.patternFile = argv[++i];
+        else if (std::strcmp(argv[i], "--resume") == 0 && i + 1 < argc)
+            options.checkpointFile = argv[++i];
+        else if (std::strcmp(argv[i], "--rule") == 0 && i + 1 < argc)
+            options.rule = argv[++i];
+        else if (std::strcmp(argv[i], "--generations") == 0 && i + 1 < argc)
+            options.generations = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--every") == 0 && i + 1 < argc)
+            options.frameInterval = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--format") == 0 && i + 1 < argc && parseFormat(argv[i + 1], options.format))
+            i++;
+        else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+            options.output = argv[++i];
+        else if (std::strcmp(argv[i], "--queue") == 0 && i + 1 < argc)
+            options.maxQueued = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            options.nbThreads = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--processes") == 0 && i + 1 < argc
+              && std::sscanf(argv[i + 1], "%zux%zu", &options.columns, &options.rows) == 2)
+            i++;
+        else if (std::strcmp(argv[i], "--halo") == 0 && i + 1 < argc)
+            options.haloWidth = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--batch") == 0 && i + 1 < argc)
+            options.nbUniverses = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+            options.firstSeed = std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--density") == 0 && i + 1 < argc)
+            options.density = std::strtod(argv[++i], nullptr);
+        else if (std::strcmp(argv[i], "--max-period") == 0 && i + 1 < argc)
+            options.maxPeriod = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        else
+        {
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (options.nbThreads != 0)
+        GameOfLife::ThreadPool::setDefaultThreadCount(options.nbThreads);
+
+    if (options.nbUniverses != 0)
+    {
+        if (!options.isEmpty())
+            exitWithError("--batch", "runs random soups, not a pattern or a checkpoint");
+        runBatch(options.width  != 0 ? options.width  : DEFAULT_BATCH_SIDE_LENGTH,
+                 options.height != 0 ? options.height : DEFAULT_BATCH_SIDE_LENGTH, options);
+        return 0;
+    }
+
+    // Without a size, a run is resumed on a grid of the size of its checkpoint
+    if (options.checkpointFile && options.width == 0 && options.height == 0)
+    {
+        GameOfLife::CheckpointReader checkpoint(options.checkpointFile);
+        if (!checkpoint.isValid())
+            exitWithError(options.checkpointFile, checkpoint.getError());
+        options.width  = checkpoint.getWidth();
+        options.height = checkpoint.getHeight();
+    }
+    const size_t width  = options.width  != 0 ? options.width  : SIDE_LENGTH;
+    const size_t height = options.height != 0 ? options.height : SIDE_LENGTH;
+
+    // Rules with more states or a larger neighborhood run on their own engine : the rule given, or else the one
+    // of the pattern, chooses it unless an engine is asked for, which must then be able to run the rule
+    std::string ruleText = options.rule ? options.rule : "";
+    std::string error;
+    if (!options.rule && options.patternFile)
+    {
+        GameOfLife::PatternInfo info;
+        if (!GameOfLife::readPatternInfo(options.patternFile, info, error))
+            exitWithError(options.patternFile, error);
+        ruleText = info.rule;
+    }
+
+    GameOfLife::Rule           rule;
+    GameOfLife::MultiStateRule multiStateRule;
+    const bool isTwoStates = ruleText.empty() || GameOfLife::Rule::parse(ruleText, rule, error);
+    const bool isKnown     = isTwoStates || GameOfLife::MultiStateRule::parse(ruleText, multiStateRule, error);
+    if (!isKnown && options.rule)
+        exitWithError(options.rule, error);
+    if (!isKnown)
+        std::cerr << options.patternFile << " : " << error << ", running the default rule" << std::endl;
+
+    const bool needsMultiState = isKnown && !isTwoStates;
+    if (!options.engine)
+        options.engine = needsMultiState ? "multistate" : "bitpacked";
+    const bool isMultiState = std::strcmp(options.engine, "multistate") == 0;
+    if (needsMultiState && !isMultiState)
+        exitWithError(options.engine, "can't run the rule " + ruleText + ", which needs the multistate engine");
+
+    if (options.columns != 0 || options.rows != 0)
+    {
+#ifndef _WIN32
+        if (std::strcmp(options.engine, "bitpacked") != 0)
+            exitWithError("--processes", "runs the bitpacked engine only");
+        runDistributed(width, height, options);
+#else
+        exitWithError("--processes", "isn't available on Windows");
+#endif
+    }
+    else if (isMultiState)
+    {
+        if (isKnown && isTwoStates && !ruleText.empty())
+            multiStateRule = GameOfLife::MultiStateRule(rule);
+
+        // The pattern's cells past the alive state are kept by a rule with as many states
+        GameOfLife::MultiStateEngine engine(width, height, isKnown && !ruleText.empty() ? multiStateRule : GameOfLife::MultiStateRule());
+        const uint64_t firstGeneration = loadStartFiles(engine, options, false);
+        if (isKnown && !ruleText.empty())
+            engine.setMultiStateRule(multiStateRule);
+        run(engine, firstGeneration, options);
+    }
+    else if (std::strcmp(options.engine, "bitpacked") == 0)
+    {
+        GameOfLife::RuntimeBitPackedEngine engine(width, height);
+        run(engine, loadStartFiles(engine, options, true), options);
+    }
+    else if (std::strcmp(options.engine, "lut") == 0)
+    {
+        // The cells are grouped by 2x2 blocks
+        if (width % 2 != 0 || height % 2 != 0)
+            exitWithError(options.engine, "runs on grids of even width and height only");
+        GameOfLife::LookupTableEngine engine(width, height);
+        run(engine, loadStartFiles(engine, options, true), options);
+    }
+    else if (std::strcmp(options.engine, "sparse") == 0)
+    {
+        GameOfLife::SparseEngine engine(width, height);
+        run(engine, loadStartFiles(engine, options, true), options);
+    }
+    else if (std::strcmp(options.engine, "cpu") == 0)
+    {
+        // SIDE_LENGTH is known at compile time
+        if (width != SIDE_LENGTH || height != SIDE_LENGTH)
+            exitWithError(options.engine, "runs on a grid of " + std::to_string(SIDE_LENGTH) + " x " + std::to_string(SIDE_LENGTH) + " cells only");
+        GameOfLife::ParallelCPUEngine<SIDE_LENGTH> engine;
+        run(engine, loadStartFiles(engine, options, true), options);
+    }
+    else
+    {
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    return 0;
+}
@@ -1,3 +1,4 @@
 #define ZOOM_FACTOR_PER_SCROLL_TICK 0.25f
 #define MOVE_AMOUNT_PER_SEC         500.f
 #define SIDE_LENGTH                 2000
+#define MAX_DISPLAY_FPS             60